@@ -0,0 +1,85 @@
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace tcatalogue {
+
+// Хранилище объектов блоками. Адреса объектов не меняются до уничтожения
+// хранилища, а соседние по времени добавления объекты лежат в памяти
+// рядом. Объекты освобождаются все сразу вместе с хранилищем.
+template <typename T>
+class ChunkedArena {
+public:
+    explicit ChunkedArena(size_t chunk_size = 1024)
+        : chunk_size_(chunk_size)
+    {}
+
+    ChunkedArena(const ChunkedArena&) = delete;
+    ChunkedArena& operator=(const ChunkedArena&) = delete;
+
+    // следующие count объектов поместятся в уже выделенную память
+    void Reserve(size_t count) {
+        if (chunks_.empty() || Free() < count) {
+            chunks_.emplace_back().reserve(count);
+        }
+    }
+
+    template <typename... Args>
+    T& Emplace(Args&&... args) {
+        if (chunks_.empty() || Free() == 0) {
+            chunks_.emplace_back().reserve(chunk_size_);
+        }
+        // емкость блока зарезервирована заранее, поэтому добавление
+        // не перемещает уже размещенные объекты
+        return chunks_.back().emplace_back(T{std::forward<Args>(args)...});
+    }
+
+private:
+    size_t Free() const {
+        return chunks_.back().capacity() - chunks_.back().size();
+    }
+
+    size_t chunk_size_;
+    std::vector<std::vector<T>> chunks_;
+};
+
+// Хранилище строк блоками: строка копируется один раз и дальше на нее
+// ссылаются представлениями, действительными до уничтожения хранилища.
+class StringArena {
+public:
+    explicit StringArena(size_t block_size = 64 * 1024)
+        : block_size_(block_size)
+    {}
+
+    StringArena(const StringArena&) = delete;
+    StringArena& operator=(const StringArena&) = delete;
+
+    std::string_view Store(std::string_view value) {
+        if (value.empty()) {
+            return {};
+        }
+        if (capacity_ - used_ < value.size()) {
+            // строка длиннее блока получает отдельный блок своего размера
+            capacity_ = std::max(block_size_, value.size());
+            blocks_.push_back(std::make_unique<char[]>(capacity_));
+            used_ = 0;
+        }
+        char* data = blocks_.back().get() + used_;
+        std::memcpy(data, value.data(), value.size());
+        used_ += value.size();
+        return {data, value.size()};
+    }
+
+private:
+    size_t block_size_;
+    std::vector<std::unique_ptr<char[]>> blocks_;
+    size_t used_ = 0;
+    size_t capacity_ = 0;
+};
+
+} // namespace tcatalogue
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+
+#include <sys/resource.h>
+
+namespace bench {
+
+// замер времени выполнения участка кода
+class Stopwatch {
+public:
+    Stopwatch()
+        : start_(std::chrono::steady_clock::now())
+    {}
+
+    double ElapsedMs() const {
+        const auto duration = std::chrono::steady_clock::now() - start_;
+        return std::chrono::duration<double, std::milli>(duration).count();
+    }
+
+private:
+    std::chrono::steady_clock::time_point start_;
+};
+
+// пиковый объем занятой процессом памяти в килобайтах
+inline size_t PeakRssKb() {
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    return static_cast<size_t>(usage.ru_maxrss);
+}
+
+// сравнение обхода графа в виде списков инцидентности и в формате CSR
+int RunGraphBench(int argc, char* argv[]);
+
+// время построения графа маршрутов и пиковая память
+int RunPrepareBench(int argc, char* argv[]);
+
+// разбор JSON из потока и из буфера
+int RunJsonBench(int argc, char* argv[]);
+
+// запись базы в разных форматах и время ее загрузки
+int RunLoadBench(int argc, char* argv[]);
+
+// поиск расстояния между остановками
+int RunDistanceBench(int argc, char* argv[]);
+
+// все этапы от разбора JSON до запросов на синтетическом городе
+int RunSuiteBench(int argc, char* argv[]);
+
+} // namespace bench
@@ -0,0 +1,51 @@
+#include "bench.h"
+
+#include <iostream>
+#include <string_view>
+
+using namespace std::literals;
+
+namespace {
+
+void PrintUsage(std::ostream& stream = std::cerr) {
+    stream << "Usage: transport_catalogue_bench graph [input.json]\n"sv
+           << "       transport_catalogue_bench prepare [input.json] [--stops N] [--buses N]"sv
+           << " [--length N] [--repeat N] [--threads N] [--on-board]\n"sv
+           << "       transport_catalogue_bench json [input.json...]\n"sv
+           << "       transport_catalogue_bench json --reader dom|stream [--stops N]\n"sv
+           << "       transport_catalogue_bench load [input.json] [--stops N] [--buses N] [--length N] [--repeat N] [--ch] [--no-graph] [--keep]\n"sv
+           << "       transport_catalogue_bench load --only protobuf|flat\n"sv
+           << "       transport_catalogue_bench distance [--stops N] [--buses N] [--length N] [--neighbors N] [--repeat N]\n"sv
+           << "       transport_catalogue_bench suite [--stops N] [--buses N] [--length N] [--ring SHARE] [--seed N]"sv
+           << " [--requests N] [--mix BUS:STOP:ROUTE:MAP] [--threads N] [--fw|--ch] [--flat]\n"sv;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        PrintUsage();
+        return EXIT_FAILURE;
+    }
+    const std::string_view mode(argv[1]);
+    if (mode == "graph"sv) {
+        return bench::RunGraphBench(argc - 2, argv + 2);
+    }
+    if (mode == "prepare"sv) {
+        return bench::RunPrepareBench(argc - 2, argv + 2);
+    }
+    if (mode == "json"sv) {
+        return bench::RunJsonBench(argc - 2, argv + 2);
+    }
+    if (mode == "load"sv) {
+        return bench::RunLoadBench(argc - 2, argv + 2);
+    }
+    if (mode == "distance"sv) {
+        return bench::RunDistanceBench(argc - 2, argv + 2);
+    }
+    if (mode == "suite"sv) {
+        return bench::RunSuiteBench(argc - 2, argv + 2);
+    }
+    PrintUsage();
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,223 @@
+#include "bench.h"
+#include "synthetic_city.h"
+
+#include "domain.h"
+#include "transport_catalogue.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+using namespace std::literals;
+
+namespace bench {
+
+namespace {
+
+using StopPair = std::pair<const domain::Stop*, const domain::Stop*>;
+
+// хеш-таблица по паре указателей, как до перехода на списки соседей
+class PairMapDistances {
+public:
+    void Set(const domain::Stop* from, const domain::Stop* to, size_t meters) {
+        distances_[{from, to}] = meters;
+    }
+
+    size_t Get(const domain::Stop* from, const domain::Stop* to) const {
+        auto it = distances_.find({from, to});
+        if (it == distances_.end()) {
+            it = distances_.find({to, from});
+            if (it == distances_.end()) {
+                return 0;
+            }
+        }
+        return it->second;
+    }
+
+    size_t Bytes() const {
+        // узел: указатель на следующий, ключ, значение и закешированный хеш
+        return distances_.bucket_count() * sizeof(void*)
+             + distances_.size() * (sizeof(void*) + sizeof(StopPair) + sizeof(size_t) + sizeof(size_t));
+    }
+
+private:
+    struct Hash {
+        size_t operator()(const StopPair & p) const noexcept {
+            auto hash_function = std::hash<const void*>{};
+            return hash_function(p.second) * 37 + hash_function(p.first);
+        }
+    };
+    std::unordered_map<StopPair, size_t, Hash> distances_;
+};
+
+// несортированные списки соседей каждой остановки с линейным поиском
+class LinearDistances {
+public:
+    explicit LinearDistances(size_t stop_count)
+        : distances_(stop_count)
+    {}
+
+    void Set(const domain::Stop* from, const domain::Stop* to, size_t meters) {
+        auto & distances = distances_[from->index];
+        for (auto & [stop_to, value] : distances) {
+            if (stop_to == to->index) {
+                value = static_cast<uint32_t>(meters);
+                return;
+            }
+        }
+        distances.emplace_back(to->index, static_cast<uint32_t>(meters));
+    }
+
+    size_t Get(const domain::Stop* from, const domain::Stop* to) const {
+        for (const auto & [stop_to, value] : distances_[from->index]) {
+            if (stop_to == to->index) {
+                return value;
+            }
+        }
+        for (const auto & [stop_to, value] : distances_[to->index]) {
+            if (stop_to == from->index) {
+                return value;
+            }
+        }
+        return 0;
+    }
+
+private:
+    std::vector<std::vector<std::pair<uint32_t, uint32_t>>> distances_;
+};
+
+// запросы расстояний: соседние остановки всех маршрутов в обе стороны,
+// как при расчете длины маршрута и построении графа, и случайные пары
+// остановок, для которых расстояние чаще всего не задано
+std::vector<StopPair> MakeQueries(const tcatalogue::TransportCatalogue & db, bool random_pairs) {
+    std::vector<StopPair> queries;
+    if (random_pairs) {
+        std::mt19937 rng(1);
+        std::uniform_int_distribution<size_t> stop_index(0, db.StopCount() - 1);
+        queries.resize(1'000'000);
+        for (StopPair & query : queries) {
+            query = {db.GetStopByIndex(stop_index(rng)), db.GetStopByIndex(stop_index(rng))};
+        }
+        return queries;
+    }
+    for (const domain::Bus* bus : db) {
+        for (size_t i = 0; i + 1 < bus->stops.size(); ++i) {
+            queries.emplace_back(bus->stops[i], bus->stops[i + 1]);
+            queries.emplace_back(bus->stops[i + 1], bus->stops[i]);
+        }
+    }
+    return queries;
+}
+
+// время одного обхода запросов, нс на запрос. сумма накапливается по
+// всем обходам, чтобы компилятор не выбросил ни один из них
+template <typename Lookup>
+double PassNs(const std::vector<StopPair> & queries, Lookup lookup, size_t & checksum) {
+    Stopwatch watch;
+    for (const auto & [from, to] : queries) {
+        checksum += lookup(from, to);
+    }
+    return watch.ElapsedMs() * 1e6 / static_cast<double>(std::max<size_t>(1, queries.size()));
+}
+
+} // namespace
+
+// время поиска расстояния между остановками в каталоге и в прежних
+// способах хранения на одних и тех же запросах
+int RunDistanceBench(int argc, char* argv[]) {
+    CityParams params;
+    params.stop_count = 100'000;
+    params.bus_count = 10'000;
+    size_t repeat = 5;
+    for (int i = 0; i < argc; ++i) {
+        const std::string_view arg(argv[i]);
+        const bool has_value = (i + 1 < argc);
+        if (arg == "--stops"sv && has_value) {
+            params.stop_count = std::stoul(argv[++i]);
+        } else if (arg == "--buses"sv && has_value) {
+            params.bus_count = std::stoul(argv[++i]);
+        } else if (arg == "--length"sv && has_value) {
+            params.route_length = std::stoul(argv[++i]);
+        } else if (arg == "--neighbors"sv && has_value) {
+            params.neighbor_count = std::stoul(argv[++i]);
+        } else if (arg == "--repeat"sv && has_value) {
+            repeat = std::max<size_t>(1, std::stoul(argv[++i]));
+        } else {
+            std::cerr << "unknown option " << arg << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    domain::STOPS stops;
+    domain::BUSES buses;
+    MakeSyntheticCity(params, stops, buses);
+    tcatalogue::TransportCatalogue db;
+    domain::FillDatabase(db, stops, buses);
+
+    size_t distance_count = 0;
+    PairMapDistances pair_map;
+    LinearDistances linear(db.StopCount());
+    for (const domain::STOP & stop : stops) {
+        const domain::Stop* from = db.GetStop(stop.stop_name_);
+        for (const auto & [name, meters] : stop.distances_) {
+            const domain::Stop* to = db.GetStop(name);
+            pair_map.Set(from, to, meters);
+            ++distance_count;
+            linear.Set(from, to, meters);
+        }
+    }
+
+    std::cout << "stops=" << params.stop_count << " buses=" << params.bus_count
+              << " neighbors=" << params.neighbor_count
+              << " pair_map_bytes=" << pair_map.Bytes()
+              // в каталоге смещение на остановку и номер соседа с расстоянием на каждое расстояние
+              << " catalogue_bytes=" << (params.stop_count + 1) * sizeof(uint32_t) + distance_count * 2 * sizeof(uint32_t)
+              << std::endl;
+    for (bool random_pairs : {false, true}) {
+        const std::vector<StopPair> queries = MakeQueries(db, random_pairs);
+        size_t checksum_map = 0;
+        size_t checksum_linear = 0;
+        size_t checksum_catalogue = 0;
+        double map_ns = 0;
+        double linear_ns = 0;
+        double catalogue_ns = 0;
+        // способы чередуются, чтобы прогрев кэшей и памяти не давал
+        // преимущества тому, кто замеряется позже
+        for (size_t i = 0; i < repeat; ++i) {
+            const double map_pass = PassNs(queries, [&pair_map](auto from, auto to) {
+                return pair_map.Get(from, to);
+            }, checksum_map);
+            const double linear_pass = PassNs(queries, [&linear](auto from, auto to) {
+                return linear.Get(from, to);
+            }, checksum_linear);
+            const double catalogue_pass = PassNs(queries, [&db](auto from, auto to) {
+                return db.GetDistanceBetween(from, to);
+            }, checksum_catalogue);
+            map_ns = (i == 0) ? map_pass : std::min(map_ns, map_pass);
+            linear_ns = (i == 0) ? linear_pass : std::min(linear_ns, linear_pass);
+            catalogue_ns = (i == 0) ? catalogue_pass : std::min(catalogue_ns, catalogue_pass);
+        }
+        if (checksum_map != checksum_catalogue || checksum_linear != checksum_catalogue) {
+            std::cerr << "distance mismatch" << std::endl;
+            return EXIT_FAILURE;
+        }
+        std::cout << std::fixed << std::setprecision(2)
+                  << (random_pairs ? "random pairs: "sv : "bus segments: "sv)
+                  << "queries=" << queries.size()
+                  << " pair_map=" << map_ns << "ns"
+                  << " linear=" << linear_ns << "ns"
+                  << " catalogue=" << catalogue_ns << "ns"
+                  << std::endl;
+    }
+    return EXIT_SUCCESS;
+}
+
+} // namespace bench
@@ -0,0 +1,148 @@
+#include "bench.h"
+
+#include "domain.h"
+#include "graph.h"
+#include "json_reader.h"
+#include "transport_catalogue.h"
+#include "transport_router.h"
+
+#include <algorithm>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <vector>
+
+namespace bench {
+
+namespace {
+
+using Weight = double;
+using Graph = graph::DirectedWeightedGraph<Weight>;
+using Csr = graph::CsrGraph<Weight>;
+
+// полный поиск Дейкстры из source. visit(vertex, relax) перебирает исходящие
+// ребра вершины и вызывает relax(target, weight) для каждого из них.
+template <typename Visit>
+double FullSearch(size_t vertex_count, graph::VertexId source, Visit visit) {
+    using Item = std::pair<Weight, graph::VertexId>;
+    std::vector<Weight> weights(vertex_count, std::numeric_limits<Weight>::infinity());
+    std::vector<Item> heap;
+    weights[source] = 0;
+    heap.push_back({0, source});
+    double checksum = 0;
+    while (!heap.empty()) {
+        std::pop_heap(heap.begin(), heap.end(), std::greater<Item>{});
+        const auto [weight, vertex] = heap.back();
+        heap.pop_back();
+        if (weight > weights[vertex]) {
+            continue;
+        }
+        checksum += weight;
+        visit(vertex, [&](graph::VertexId target, Weight edge_weight) {
+            const Weight candidate_weight = weight + edge_weight;
+            if (candidate_weight < weights[target]) {
+                weights[target] = candidate_weight;
+                heap.push_back({candidate_weight, target});
+                std::push_heap(heap.begin(), heap.end(), std::greater<Item>{});
+            }
+        });
+    }
+    return checksum;
+}
+
+void Compare(std::string_view name, const Graph& graph, size_t searches) {
+    Stopwatch freeze_watch;
+    const Csr csr(graph);
+    const double freeze_ms = freeze_watch.ElapsedMs();
+
+    std::mt19937 rng(42);
+    std::vector<graph::VertexId> sources(searches);
+    for (auto& source : sources) {
+        source = rng() % graph.GetVertexCount();
+    }
+
+    double checksum_lists = 0;
+    Stopwatch lists_watch;
+    for (graph::VertexId source : sources) {
+        checksum_lists += FullSearch(graph.GetVertexCount(), source, [&graph](graph::VertexId vertex, auto relax) {
+            for (graph::EdgeId edge_id : graph.GetIncidentEdges(vertex)) {
+                const auto& edge = graph.GetEdge(edge_id);
+                relax(edge.to, edge.weight);
+            }
+        });
+    }
+    const double lists_ms = lists_watch.ElapsedMs();
+
+    double checksum_csr = 0;
+    Stopwatch csr_watch;
+    for (graph::VertexId source : sources) {
+        checksum_csr += FullSearch(csr.GetVertexCount(), source, [&csr](graph::VertexId vertex, auto relax) {
+            for (size_t slot = csr.EdgesBegin(vertex), end = csr.EdgesEnd(vertex); slot < end; ++slot) {
+                relax(csr.GetTarget(slot), csr.GetWeight(slot));
+            }
+        });
+    }
+    const double csr_ms = csr_watch.ElapsedMs();
+
+    std::cout << std::fixed << std::setprecision(3)
+              << name << ": V=" << graph.GetVertexCount() << " E=" << graph.GetEdgeCount()
+              << " searches=" << searches
+              << " lists=" << lists_ms / searches << "ms"
+              << " csr=" << csr_ms / searches << "ms"
+              << " speedup=" << lists_ms / csr_ms << "x"
+              << " freeze=" << freeze_ms << "ms"
+              << (checksum_lists == checksum_csr ? "" : " CHECKSUM MISMATCH")
+              << std::endl;
+}
+
+// граф, похожий на транспортную сеть: вершины на окружностях со связями
+// к ближайшим соседям и редкими дальними связями
+Graph MakeSyntheticGraph(size_t vertex_count, size_t degree, std::mt19937& rng) {
+    Graph graph(vertex_count);
+    std::uniform_real_distribution<Weight> weights(1.0, 10.0);
+    for (graph::VertexId from = 0; from < vertex_count; ++from) {
+        for (size_t i = 0; i < degree; ++i) {
+            const graph::VertexId to = (i + 1 < degree)
+                ? (from + 1 + rng() % 16) % vertex_count
+                : rng() % vertex_count;
+            graph.AddEdge({from, to, weights(rng)});
+        }
+    }
+    return graph;
+}
+
+} // namespace
+
+int RunGraphBench(int argc, char* argv[]) {
+    if (argc > 0) {
+        std::ifstream input(argv[0]);
+        tcatalogue::JsonReader reader(input);
+        if (!reader.IsOk()) {
+            std::cerr << "can't parse " << argv[0] << std::endl;
+            return EXIT_FAILURE;
+        }
+        domain::STOPS stops;
+        domain::BUSES buses;
+        reader.ParseInput(stops, buses);
+        auto routing_settings = reader.ParseRoutingSettings().value();
+        routing_settings.router_type = domain::RouterType::DIJKSTRA;
+
+        tcatalogue::TransportCatalogue db;
+        domain::FillDatabase(db, stops, buses);
+        RouteGraph route_graph(db, routing_settings);
+        route_graph.Prepare();
+        Compare(argv[0], route_graph.GetGraph(), 2000);
+    }
+
+    std::mt19937 rng(1);
+    for (size_t vertex_count : {10'000, 100'000, 1'000'000}) {
+        const Graph graph = MakeSyntheticGraph(vertex_count, 4, rng);
+        Compare("synthetic", graph, std::max<size_t>(10, 2'000'000 / vertex_count));
+    }
+    return EXIT_SUCCESS;
+}
+
+} // namespace bench
@@ -0,0 +1,180 @@
+#include "bench.h"
+#include "synthetic_city.h"
+
+#include "domain.h"
+#include "json.h"
+#include "json_reader.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std::literals;
+
+namespace bench {
+
+namespace {
+
+// разбор одного документа потоковым json::Load и буферным json::LoadBuffer
+bool Compare(std::string_view name, const std::string & text, size_t repeat) {
+    double stream_ms = 0;
+    double buffer_ms = 0;
+    bool same = true;
+    for (size_t i = 0; i < repeat; ++i) {
+        std::istringstream input(text);
+        Stopwatch stream_watch;
+        const json::Document stream_doc = json::Load(input);
+        stream_ms += stream_watch.ElapsedMs();
+
+        Stopwatch buffer_watch;
+        const json::Document buffer_doc = json::LoadBuffer(text);
+        buffer_ms += buffer_watch.ElapsedMs();
+
+        same = same && (stream_doc == buffer_doc);
+    }
+    stream_ms /= repeat;
+    buffer_ms /= repeat;
+    const double megabytes = text.size() / (1024.0 * 1024.0);
+    std::cout << std::fixed << std::setprecision(3)
+              << name << ": size=" << megabytes << "MB"
+              << " stream=" << stream_ms << "ms (" << megabytes * 1000 / stream_ms << "MB/s)"
+              << " buffer=" << buffer_ms << "ms (" << megabytes * 1000 / buffer_ms << "MB/s)"
+              << " speedup=" << stream_ms / buffer_ms << "x"
+              << (same ? "" : " DOCUMENTS DIFFER")
+              << std::endl;
+    return same;
+}
+
+bool SameStops(const domain::STOPS & lhs, const domain::STOPS & rhs) {
+    return std::equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(),
+        [](const domain::STOP & l, const domain::STOP & r) {
+            return l.stop_name_ == r.stop_name_
+                && l.coordinates_.lat == r.coordinates_.lat
+                && l.coordinates_.lng == r.coordinates_.lng
+                && l.distances_ == r.distances_;
+        });
+}
+
+bool SameBuses(const domain::BUSES & lhs, const domain::BUSES & rhs) {
+    return std::equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(),
+        [](const domain::BUS & l, const domain::BUS & r) {
+            return l.bus_id_ == r.bus_id_
+                && l.is_round_trip_ == r.is_round_trip_
+                && l.stops_ == r.stops_;
+        });
+}
+
+// чтение base_requests через документ и потоковым разбором
+bool CompareReaders(std::string_view name, const std::string & text) {
+    domain::STOPS dom_stops;
+    domain::BUSES dom_buses;
+    Stopwatch dom_watch;
+    {
+        std::istringstream input(text);
+        tcatalogue::JsonReader reader(input);
+        if (!reader.IsOk()) {
+            std::cerr << "can't parse " << name << std::endl;
+            return false;
+        }
+        reader.ParseInput(dom_stops, dom_buses);
+    }
+    const double dom_ms = dom_watch.ElapsedMs();
+
+    domain::STOPS stream_stops;
+    domain::BUSES stream_buses;
+    Stopwatch stream_watch;
+    {
+        std::istringstream input(text);
+        tcatalogue::JsonReader reader(input, stream_stops, stream_buses);
+        if (!reader.IsOk()) {
+            std::cerr << "can't parse " << name << std::endl;
+            return false;
+        }
+    }
+    const double stream_ms = stream_watch.ElapsedMs();
+
+    const bool same = SameStops(dom_stops, stream_stops) && SameBuses(dom_buses, stream_buses);
+    std::cout << std::fixed << std::setprecision(3)
+              << name << ": reader dom=" << dom_ms << "ms stream=" << stream_ms << "ms"
+              << " speedup=" << dom_ms / stream_ms << "x"
+              << (same ? "" : " STOPS/BUSES DIFFER")
+              << std::endl;
+    return same;
+}
+
+// пиковая память одного способа чтения. запускать отдельным процессом
+int RunReaderMemory(std::string_view mode, const CityParams & params) {
+    std::string text;
+    {
+        std::ostringstream output;
+        WriteSyntheticCityJson(params, output);
+        text = output.str();
+    }
+    const size_t rss_before_kb = PeakRssKb();
+    domain::STOPS stops;
+    domain::BUSES buses;
+    Stopwatch watch;
+    std::istringstream input(std::move(text));
+    if (mode == "dom"sv) {
+        tcatalogue::JsonReader reader(input);
+        reader.ParseInput(stops, buses);
+    } else if (mode == "stream"sv) {
+        tcatalogue::JsonReader reader(input, stops, buses);
+    } else {
+        std::cerr << "unknown reader " << mode << std::endl;
+        return EXIT_FAILURE;
+    }
+    const double ms = watch.ElapsedMs();
+    std::cout << std::fixed << std::setprecision(3)
+              << "reader=" << mode << " stops=" << stops.size() << " buses=" << buses.size()
+              << " time=" << ms << "ms"
+              << " peak_rss=" << PeakRssKb() << "KB"
+              << " reader_rss=" << PeakRssKb() - rss_before_kb << "KB"
+              << std::endl;
+    return EXIT_SUCCESS;
+}
+
+} // namespace
+
+int RunJsonBench(int argc, char* argv[]) {
+    if (argc >= 2 && argv[0] == "--reader"sv) {
+        CityParams params;
+        params.stop_count = (argc >= 4 && argv[2] == "--stops"sv) ? std::stoul(argv[3]) : 200'000;
+        params.bus_count = params.stop_count / 10;
+        params.route_length = 50;
+        return RunReaderMemory(argv[1], params);
+    }
+
+    bool ok = true;
+    for (int i = 0; i < argc; ++i) {
+        std::ifstream input(argv[i], std::ios::binary);
+        if (!input) {
+            std::cerr << "can't open " << argv[i] << std::endl;
+            return EXIT_FAILURE;
+        }
+        std::stringstream text;
+        text << input.rdbuf();
+        ok = Compare(argv[i], text.str(), 5) && ok;
+        ok = CompareReaders(argv[i], text.str()) && ok;
+    }
+
+    for (size_t stop_count : {20'000, 200'000}) {
+        CityParams params;
+        params.stop_count = stop_count;
+        params.bus_count = stop_count / 10;
+        params.route_length = 50;
+        std::ostringstream text;
+        WriteSyntheticCityJson(params, text);
+        const std::string name = "synthetic stops="s + std::to_string(stop_count);
+        ok = Compare(name, text.str(), 1) && ok;
+        ok = CompareReaders(name, text.str()) && ok;
+    }
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+} // namespace bench
@@ -0,0 +1,201 @@
+#include "bench.h"
+#include "synthetic_city.h"
+
+#include "domain.h"
+#include "geo.h"
+#include "json_reader.h"
+#include "serialization.h"
+#include "transport_catalogue.h"
+#include "transport_router.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <string_view>
+
+using namespace std::literals;
+
+namespace bench {
+
+namespace {
+
+// способ загрузки базы в каталог
+struct LoadVariant {
+    std::string_view name;
+    domain::BaseFormat format;
+};
+
+const LoadVariant LOAD_VARIANTS[] = {
+    {"protobuf"sv, domain::BaseFormat::PROTOBUF},
+    {"flat"sv,     domain::BaseFormat::FLAT},
+};
+
+std::string BaseFile(domain::BaseFormat format) {
+    return format == domain::BaseFormat::FLAT ? "transport_catalogue_bench_flat.db"s
+                                              : "transport_catalogue_bench_protobuf.db"s;
+}
+
+size_t FileSize(const std::string & path) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    return file ? static_cast<size_t>(file.tellg()) : 0;
+}
+
+bool Load(const LoadVariant & variant, tcatalogue::TransportCatalogue & db) {
+    Serialization::Context context;
+    context.serialize_settings = domain::SerializeSettings{BaseFile(variant.format)};
+    return Serialization::Load(context, db);
+}
+
+// один способ загрузки уже записанной базы. пиковая память процесса не
+// уменьшается, поэтому для ее замера способ запускается отдельным процессом
+int RunSingleLoad(std::string_view name) {
+    auto it = std::find_if(std::begin(LOAD_VARIANTS), std::end(LOAD_VARIANTS),
+                           [name](const LoadVariant & variant) { return variant.name == name; });
+    if (it == std::end(LOAD_VARIANTS)) {
+        std::cerr << "unknown variant " << name << std::endl;
+        return EXIT_FAILURE;
+    }
+    const size_t rss_before_kb = PeakRssKb();
+    auto db = std::make_unique<tcatalogue::TransportCatalogue>();
+    Stopwatch watch;
+    if (!Load(*it, *db)) {
+        std::cerr << "can't load " << BaseFile(it->format) << ", run `load --keep` first" << std::endl;
+        return EXIT_FAILURE;
+    }
+    const double load_ms = watch.ElapsedMs();
+    const size_t peak_rss_kb = PeakRssKb();
+
+    // обход всех маршрутов, как при расчете их длины
+    Stopwatch walk_watch;
+    double total_length = 0;
+    for (size_t i = 0; i < db->BusCount(); ++i) {
+        const domain::Bus * bus = db->GetBusByIndex(i);
+        for (size_t j = 0; j + 1 < bus->stops.size(); ++j) {
+            total_length += geo::ComputeDistance(bus->stops[j]->coordinates, bus->stops[j + 1]->coordinates);
+            total_length += db->GetDistanceBetween(bus->stops[j], bus->stops[j + 1]);
+        }
+    }
+    const double walk_ms = walk_watch.ElapsedMs();
+    const size_t stop_count = db->StopCount();
+    const size_t bus_count = db->BusCount();
+
+    Stopwatch teardown_watch;
+    db.reset();
+    const double teardown_ms = teardown_watch.ElapsedMs();
+
+    std::cout << std::fixed << std::setprecision(3)
+              << name << ": stops=" << stop_count << " buses=" << bus_count
+              << " load=" << load_ms << "ms"
+              << " walk=" << walk_ms << "ms"
+              << " teardown=" << teardown_ms << "ms"
+              << " peak_rss=" << peak_rss_kb << "KB"
+              << " load_rss=" << peak_rss_kb - rss_before_kb << "KB"
+              << " (length " << static_cast<size_t>(total_length) << ")"
+              << std::endl;
+    return EXIT_SUCCESS;
+}
+
+} // namespace
+
+// запись базы в каждом из форматов и время ее чтения в каталог,
+// как это делает process_requests
+int RunLoadBench(int argc, char* argv[]) {
+    CityParams params;
+    params.stop_count = 20'000;
+    params.bus_count = 2'000;
+    domain::RouterType router_type = domain::RouterType::DIJKSTRA;
+    size_t repeat = 5;
+    bool keep = false;
+    bool with_graph = true;
+    std::string input_file;
+    for (int i = 0; i < argc; ++i) {
+        const std::string_view arg(argv[i]);
+        const bool has_value = (i + 1 < argc);
+        if (arg == "--only"sv && has_value) {
+            return RunSingleLoad(argv[i + 1]);
+        } else if (arg == "--stops"sv && has_value) {
+            params.stop_count = std::stoul(argv[++i]);
+        } else if (arg == "--buses"sv && has_value) {
+            params.bus_count = std::stoul(argv[++i]);
+        } else if (arg == "--length"sv && has_value) {
+            params.route_length = std::stoul(argv[++i]);
+        } else if (arg == "--repeat"sv && has_value) {
+            repeat = std::max<size_t>(1, std::stoul(argv[++i]));
+        } else if (arg == "--ch"sv) {
+            router_type = domain::RouterType::CONTRACTION_HIERARCHIES;
+        } else if (arg == "--keep"sv) {
+            keep = true;
+        } else if (arg == "--no-graph"sv) {
+            // без графа время и память определяются загрузкой самого каталога
+            with_graph = false;
+        } else if (arg.substr(0, 2) != "--"sv) {
+            input_file = std::string(arg);
+        } else {
+            std::cerr << "unknown option " << arg << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    Serialization::Context context;
+    {
+        std::stringstream text;
+        if (!input_file.empty()) {
+            text << std::ifstream(input_file).rdbuf();
+        } else {
+            WriteSyntheticCityJson(params, text);
+        }
+        tcatalogue::JsonReader reader(text, context.stops, context.busses);
+        if (!reader.IsOk()) {
+            std::cerr << "can't parse " << input_file << std::endl;
+            return EXIT_FAILURE;
+        }
+        context.serialize_settings = reader.ParseSerializeSettings();
+        context.render_settings = reader.ParseRenderSettings();
+        context.routing_settings = reader.ParseRoutingSettings();
+    }
+    context.routing_settings->router_type = router_type;
+    if (with_graph) {
+        tcatalogue::TransportCatalogue db;
+        domain::FillDatabase(db, context.stops, context.busses);
+        RouteGraph route_graph(db, context.routing_settings.value());
+        route_graph.Prepare();
+        context.route_graph = route_graph.Save();
+    }
+    for (domain::BaseFormat format : {domain::BaseFormat::PROTOBUF, domain::BaseFormat::FLAT}) {
+        context.serialize_settings->file = BaseFile(format);
+        context.serialize_settings->format = format;
+        Serialization::Write(context);
+    }
+
+    for (const LoadVariant & variant : LOAD_VARIANTS) {
+        double best_ms = 0;
+        for (size_t i = 0; i < repeat; ++i) {
+            tcatalogue::TransportCatalogue db;
+            Stopwatch watch;
+            if (!Load(variant, db)) {
+                std::cerr << "can't load " << BaseFile(variant.format) << std::endl;
+                return EXIT_FAILURE;
+            }
+            const double ms = watch.ElapsedMs();
+            best_ms = (i == 0) ? ms : std::min(best_ms, ms);
+        }
+        std::cout << std::fixed << std::setprecision(3)
+                  << (input_file.empty() ? "synthetic"s : input_file) << " " << variant.name << ":"
+                  << " stops=" << context.stops.size() << " buses=" << context.busses.size()
+                  << " size=" << FileSize(BaseFile(variant.format)) / 1024 << "KB"
+                  << " load_best=" << best_ms << "ms"
+                  << std::endl;
+    }
+    if (!keep) {
+        std::remove(BaseFile(domain::BaseFormat::PROTOBUF).c_str());
+        std::remove(BaseFile(domain::BaseFormat::FLAT).c_str());
+    }
+    return EXIT_SUCCESS;
+}
+
+} // namespace bench
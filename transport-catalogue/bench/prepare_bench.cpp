@@ -0,0 +1,105 @@
+#include "bench.h"
+#include "synthetic_city.h"
+
+#include "domain.h"
+#include "json_reader.h"
+#include "transport_catalogue.h"
+#include "transport_router.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <string_view>
+
+using namespace std::literals;
+
+namespace bench {
+
+// построение графа маршрутов: время RouteGraph::Prepare() и пиковая память.
+// пиковая память процесса не уменьшается, поэтому для честного сравнения
+// каждую конфигурацию следует запускать отдельным процессом.
+int RunPrepareBench(int argc, char* argv[]) {
+    CityParams params;
+    std::string input_file;
+    domain::RoutingSettings routing_settings{40, 6};
+    size_t repeat = 5;
+    size_t threads = 1;
+    for (int i = 0; i < argc; ++i) {
+        const std::string_view arg(argv[i]);
+        const bool has_value = (i + 1 < argc);
+        if (arg == "--stops"sv && has_value) {
+            params.stop_count = std::stoul(argv[++i]);
+        } else if (arg == "--buses"sv && has_value) {
+            params.bus_count = std::stoul(argv[++i]);
+        } else if (arg == "--length"sv && has_value) {
+            params.route_length = std::stoul(argv[++i]);
+        } else if (arg == "--repeat"sv && has_value) {
+            repeat = std::max<size_t>(1, std::stoul(argv[++i]));
+        } else if (arg == "--threads"sv && has_value) {
+            threads = std::max<size_t>(1, std::stoul(argv[++i]));
+        } else if (arg == "--on-board"sv) {
+            routing_settings.graph_model = domain::GraphModel::ON_BOARD;
+        } else if (arg.substr(0, 2) != "--"sv) {
+            input_file = std::string(arg);
+        } else {
+            std::cerr << "unknown option " << arg << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    domain::STOPS stops;
+    domain::BUSES buses;
+    if (!input_file.empty()) {
+        std::ifstream input(input_file);
+        tcatalogue::JsonReader reader(input);
+        if (!reader.IsOk()) {
+            std::cerr << "can't parse " << input_file << std::endl;
+            return EXIT_FAILURE;
+        }
+        reader.ParseInput(stops, buses);
+        if (auto settings = reader.ParseRoutingSettings(); settings.has_value()) {
+            routing_settings.bus_wait_time = settings->bus_wait_time;
+            routing_settings.bus_velocity  = settings->bus_velocity;
+        }
+    } else {
+        MakeSyntheticCity(params, stops, buses);
+    }
+    // маршрутизатор Дейкстры почти ничего не предвычисляет, поэтому время
+    // Prepare() определяется построением графа
+    routing_settings.router_type = domain::RouterType::DIJKSTRA;
+
+    tcatalogue::TransportCatalogue db;
+    domain::FillDatabase(db, stops, buses);
+    const size_t rss_before_kb = PeakRssKb();
+
+    double best_ms = 0;
+    double total_ms = 0;
+    size_t vertex_count = 0;
+    size_t edge_count = 0;
+    for (size_t i = 0; i < repeat; ++i) {
+        RouteGraph route_graph(db, routing_settings);
+        Stopwatch watch;
+        route_graph.Prepare(threads);
+        const double ms = watch.ElapsedMs();
+        best_ms = (i == 0) ? ms : std::min(best_ms, ms);
+        total_ms += ms;
+        vertex_count = route_graph.GetGraph().GetVertexCount();
+        edge_count   = route_graph.GetGraph().GetEdgeCount();
+    }
+
+    std::cout << std::fixed << std::setprecision(3)
+              << (input_file.empty() ? "synthetic"s : input_file) << ":"
+              << " stops=" << db.StopCount() << " buses=" << db.BusCount()
+              << " threads=" << threads
+              << " V=" << vertex_count << " E=" << edge_count
+              << " prepare_best=" << best_ms << "ms"
+              << " prepare_avg=" << total_ms / repeat << "ms"
+              << " peak_rss=" << PeakRssKb() << "KB"
+              << " graph_rss=" << PeakRssKb() - rss_before_kb << "KB"
+              << std::endl;
+    return EXIT_SUCCESS;
+}
+
+} // namespace bench
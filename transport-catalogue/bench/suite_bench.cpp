@@ -0,0 +1,295 @@
+#include "bench.h"
+#include "synthetic_city.h"
+
+#include "domain.h"
+#include "json_reader.h"
+#include "map_renderer.h"
+#include "request_handler.h"
+#include "serialization.h"
+#include "transport_catalogue.h"
+#include "transport_router.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std::literals;
+
+namespace bench {
+
+namespace {
+
+const std::string SUITE_BASE_FILE = "transport_catalogue_bench_suite.db"s;
+
+// время этапа и пиковая память процесса после него
+struct PhaseResult {
+    std::string_view name;
+    double ms = 0;
+    size_t peak_rss_kb = 0;
+};
+
+void PrintPhase(const PhaseResult & phase) {
+    std::cout << std::fixed << std::setprecision(3)
+              << "  " << std::left << std::setw(16) << phase.name << std::right
+              << std::setw(12) << phase.ms << " ms"
+              << std::setw(12) << phase.peak_rss_kb << " KB peak_rss"
+              << std::endl;
+}
+
+// значение, которого не превышает доля share замеров. samples отсортированы
+double Percentile(const std::vector<double> & samples, double share) {
+    if (samples.empty()) {
+        return 0;
+    }
+    const size_t rank = static_cast<size_t>(share * static_cast<double>(samples.size() - 1) + 0.5);
+    return samples[std::min(rank, samples.size() - 1)];
+}
+
+void PrintLatencies(std::string_view name, std::vector<double> & samples_us) {
+    if (samples_us.empty()) {
+        return;
+    }
+    std::sort(samples_us.begin(), samples_us.end());
+    double total_us = 0;
+    for (double us : samples_us) {
+        total_us += us;
+    }
+    std::cout << std::fixed << std::setprecision(1)
+              << "  " << std::left << std::setw(8) << name << std::right
+              << " count=" << samples_us.size()
+              << " rps=" << static_cast<size_t>(samples_us.size() * 1e6 / std::max(total_us, 1e-3))
+              << " p50=" << Percentile(samples_us, 0.50) << "us"
+              << " p90=" << Percentile(samples_us, 0.90) << "us"
+              << " p99=" << Percentile(samples_us, 0.99) << "us"
+              << " max=" << samples_us.back() << "us"
+              << std::endl;
+}
+
+std::string_view RequestTypeName(const domain::STAT_REQUEST & request) {
+    if (request.IsBus()) {
+        return "Bus"sv;
+    } else if (request.IsStop()) {
+        return "Stop"sv;
+    } else if (request.IsRoute()) {
+        return "Route"sv;
+    }
+    return "Map"sv;
+}
+
+bool ParseRequestMix(std::string_view text, RequestMix & mix) {
+    size_t weights[4] = {};
+    for (size_t & weight : weights) {
+        const size_t end = std::min(text.find(':'), text.size());
+        if (end == 0) {
+            return false;
+        }
+        weight = std::stoul(std::string(text.substr(0, end)));
+        text.remove_prefix(std::min(end + 1, text.size()));
+    }
+    mix.bus = weights[0];
+    mix.stop = weights[1];
+    mix.route = weights[2];
+    mix.map = weights[3];
+    return text.empty();
+}
+
+} // namespace
+
+// все этапы работы справочника на синтетическом городе по порядку, как их
+// проходят make_base и process_requests: разбор JSON, заполнение каталога,
+// построение графа, запись и чтение базы, загрузка графа с маршрутизатором,
+// затем запросы по одному с задержками по типам и все сразу в threads потоков.
+// пиковая память процесса не уменьшается, поэтому после каждого этапа
+// видно, сколько он добавил.
+int RunSuiteBench(int argc, char* argv[]) {
+    CityParams params;
+    params.stop_count = 10'000;
+    params.bus_count = 1'000;
+    RequestMix mix;
+    domain::RouterType router_type = domain::RouterType::DIJKSTRA;
+    domain::BaseFormat format = domain::BaseFormat::PROTOBUF;
+    size_t threads = 1;
+    for (int i = 0; i < argc; ++i) {
+        const std::string_view arg(argv[i]);
+        const bool has_value = (i + 1 < argc);
+        if (arg == "--stops"sv && has_value) {
+            params.stop_count = std::stoul(argv[++i]);
+        } else if (arg == "--buses"sv && has_value) {
+            params.bus_count = std::stoul(argv[++i]);
+        } else if (arg == "--length"sv && has_value) {
+            params.route_length = std::stoul(argv[++i]);
+        } else if (arg == "--ring"sv && has_value) {
+            params.ring_share = std::clamp(std::stod(argv[++i]), 0.0, 1.0);
+        } else if (arg == "--seed"sv && has_value) {
+            params.seed = static_cast<uint32_t>(std::stoul(argv[++i]));
+        } else if (arg == "--requests"sv && has_value) {
+            mix.count = std::stoul(argv[++i]);
+        } else if (arg == "--mix"sv && has_value) {
+            if (!ParseRequestMix(argv[++i], mix)) {
+                std::cerr << "--mix expects bus:stop:route:map weights" << std::endl;
+                return EXIT_FAILURE;
+            }
+        } else if (arg == "--threads"sv && has_value) {
+            threads = std::max<size_t>(1, std::stoul(argv[++i]));
+        } else if (arg == "--fw"sv) {
+            router_type = domain::RouterType::FLOYD_WARSHALL;
+        } else if (arg == "--ch"sv) {
+            router_type = domain::RouterType::CONTRACTION_HIERARCHIES;
+        } else if (arg == "--flat"sv) {
+            format = domain::BaseFormat::FLAT;
+        } else {
+            std::cerr << "unknown option " << arg << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    if (params.stop_count < 2 || params.bus_count == 0 || params.route_length < 2) {
+        std::cerr << "the city needs at least 2 stops, 1 bus and 2 stops per route" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::string base_text;
+    std::string requests_text;
+    {
+        std::ostringstream base_stream;
+        WriteSyntheticCityJson(params, base_stream);
+        base_text = base_stream.str();
+        std::ostringstream requests_stream;
+        WriteSyntheticRequestsJson(params, mix, requests_stream);
+        requests_text = requests_stream.str();
+    }
+    std::cout << "synthetic city: stops=" << params.stop_count << " buses=" << params.bus_count
+              << " length=" << params.route_length << " ring=" << params.ring_share
+              << " requests=" << mix.count << " mix=" << mix.bus << ":" << mix.stop << ":"
+              << mix.route << ":" << mix.map << " threads=" << threads
+              << " json=" << (base_text.size() + requests_text.size()) / 1024 << "KB" << std::endl;
+
+    auto run_phase = [](std::string_view name, const auto & action) {
+        Stopwatch watch;
+        action();
+        PrintPhase({name, watch.ElapsedMs(), PeakRssKb()});
+    };
+
+    // make_base
+    Serialization::Context context;
+    domain::STAT_REQUESTS stat_requests;
+    bool parsed = true;
+    run_phase("json_parse"sv, [&]() {
+        std::istringstream base_input(base_text);
+        tcatalogue::JsonReader reader(base_input, context.stops, context.busses);
+        std::istringstream requests_input(requests_text);
+        tcatalogue::JsonReader requests_reader(requests_input);
+        parsed = reader.IsOk() && requests_reader.IsOk();
+        if (parsed) {
+            context.serialize_settings = reader.ParseSerializeSettings();
+            context.render_settings = reader.ParseRenderSettings();
+            context.routing_settings = reader.ParseRoutingSettings();
+            requests_reader.ParseStatRequests(stat_requests);
+        }
+    });
+    if (!parsed) {
+        std::cerr << "can't parse the synthetic city" << std::endl;
+        return EXIT_FAILURE;
+    }
+    base_text = std::string();
+    requests_text = std::string();
+    context.serialize_settings->file = SUITE_BASE_FILE;
+    context.serialize_settings->format = format;
+    context.routing_settings->router_type = router_type;
+    const domain::RoutingSettings routing_settings = context.routing_settings.value();
+
+    {
+        tcatalogue::TransportCatalogue db;
+        run_phase("fill_database"sv, [&]() {
+            domain::FillDatabase(db, context.stops, context.busses);
+        });
+        run_phase("graph_prepare"sv, [&]() {
+            RouteGraph route_graph(db, routing_settings);
+            route_graph.Prepare(threads);
+            context.route_graph = route_graph.Save();
+        });
+        context.bus_stats = db.GetAllBusStats();
+        run_phase("base_write"sv, [&]() {
+            Serialization::Write(context);
+        });
+    }
+    context = Serialization::Context{};
+    context.serialize_settings = domain::SerializeSettings{SUITE_BASE_FILE};
+
+    // process_requests
+    tcatalogue::TransportCatalogue db;
+    bool loaded = true;
+    run_phase("base_read"sv, [&]() {
+        loaded = Serialization::Load(context, db);
+    });
+    std::remove(SUITE_BASE_FILE.c_str());
+    if (!loaded || !context.route_graph.has_value()) {
+        std::cerr << "can't load " << SUITE_BASE_FILE << std::endl;
+        return EXIT_FAILURE;
+    }
+    renderer::MapRenderer drawer(context.render_settings.value());
+    RequestHandler handler(db, drawer, context.routing_settings.value());
+    run_phase("router_load"sv, [&]() {
+        loaded = handler.LoadRouteGraph(std::move(context.route_graph.value()));
+        context.route_graph.reset();
+    });
+    if (!loaded) {
+        std::cerr << "can't load route graph from " << SUITE_BASE_FILE << std::endl;
+        return EXIT_FAILURE;
+    }
+    run_phase("map_render"sv, [&]() {
+        handler.DrawMap();
+    });
+
+    // каждый запрос отдельно, с разбором отклика как в process_requests
+    std::vector<double> bus_us;
+    std::vector<double> stop_us;
+    std::vector<double> route_us;
+    std::vector<double> map_us;
+    run_phase("queries_single"sv, [&]() {
+        domain::STAT_REQUESTS single;
+        domain::STAT_RESPONSES responses;
+        for (const domain::STAT_REQUEST & request : stat_requests) {
+            single.assign(1, request);
+            Stopwatch watch;
+            domain::FillStatResponses(handler, single, responses);
+            const double us = watch.ElapsedMs() * 1000.0;
+            const std::string_view type = RequestTypeName(request);
+            (type == "Bus"sv ? bus_us : type == "Stop"sv ? stop_us : type == "Route"sv ? route_us : map_us).push_back(us);
+        }
+    });
+    double batch_ms = 0;
+    run_phase("queries_batch"sv, [&]() {
+        Stopwatch watch;
+        domain::STAT_RESPONSES responses;
+        domain::FillStatResponses(handler, stat_requests, responses, threads);
+        batch_ms = watch.ElapsedMs();
+    });
+
+    std::cout << "latency:" << std::endl;
+    PrintLatencies("Bus"sv, bus_us);
+    PrintLatencies("Stop"sv, stop_us);
+    PrintLatencies("Route"sv, route_us);
+    PrintLatencies("Map"sv, map_us);
+    std::cout << std::fixed << std::setprecision(1)
+              << "batch: " << stat_requests.size() << " requests in " << batch_ms << " ms, "
+              << static_cast<size_t>(stat_requests.size() * 1000.0 / std::max(batch_ms, 1e-3)) << " rps"
+              << " on " << threads << " threads" << std::endl;
+    // пакет повторяет запросы одиночного прохода, поэтому его Route
+    // отвечаются из кеша, если он вмещает все пары
+    if (const auto stats = handler.GetRouteCacheStats()) {
+        std::cout << "route_cache: hits=" << stats->hits << " misses=" << stats->misses
+                  << " evictions=" << stats->evictions << " entries=" << stats->entries
+                  << " bytes=" << stats->bytes << "/" << stats->capacity_bytes << std::endl;
+    }
+    std::cout << "peak_rss=" << PeakRssKb() << "KB" << std::endl;
+    return EXIT_SUCCESS;
+}
+
+} // namespace bench
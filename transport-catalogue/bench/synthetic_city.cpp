@@ -0,0 +1,145 @@
+#include "synthetic_city.h"
+
+#include "json_writer.h"
+
+#include <random>
+#include <string>
+
+namespace bench {
+
+namespace {
+
+std::string StopName(size_t index) {
+    return "Stop " + std::to_string(index);
+}
+
+} // namespace
+
+void MakeSyntheticCity(const CityParams & params, domain::STOPS & stops, domain::BUSES & buses) {
+    std::mt19937 rng(params.seed);
+    std::uniform_real_distribution<double> offset(0.0, 0.1);
+    std::uniform_int_distribution<size_t> distance(100, 2000);
+    std::uniform_int_distribution<size_t> stop_index(0, params.stop_count - 1);
+
+    for (size_t i = 0; i < params.stop_count; ++i) {
+        domain::STOP stop;
+        stop.stop_name_   = StopName(i);
+        stop.coordinates_ = {55.6 + offset(rng), 37.5 + offset(rng)};
+        // расстояния до соседей по нумерации, чтобы маршруты из соседних
+        // остановок имели заданные дороги
+        for (size_t k = 1; k <= params.neighbor_count; ++k) {
+            stop.distances_.emplace_back(StopName((i + k) % params.stop_count), distance(rng));
+        }
+        stops.push_back(std::move(stop));
+    }
+
+    for (size_t b = 0; b < params.bus_count; ++b) {
+        domain::BUS bus;
+        bus.bus_id_        = std::to_string(b);
+        // кольцевой, если на нем доля ring_share набирает очередной целый маршрут
+        bus.is_round_trip_ = static_cast<size_t>((b + 1) * params.ring_share)
+                           > static_cast<size_t>(b * params.ring_share);
+        // маршрут идет по соседним остановкам со случайными пропусками
+        size_t current = stop_index(rng);
+        for (size_t k = 0; k < params.route_length; ++k) {
+            bus.stops_.push_back(StopName(current));
+            current = (current + 1 + rng() % 3) % params.stop_count;
+        }
+        if (bus.is_round_trip_) {
+            bus.stops_.push_back(bus.stops_.front());
+        }
+        buses.push_back(std::move(bus));
+    }
+}
+
+void WriteSyntheticCityJson(const CityParams & params, std::ostream & out) {
+    domain::STOPS stops;
+    domain::BUSES buses;
+    MakeSyntheticCity(params, stops, buses);
+
+    json::Writer writer(out);
+    writer.StartDict()
+        .Key("base_requests").StartArray();
+    for (const domain::STOP & stop : stops) {
+        writer.StartDict()
+            .Key("type").Value("Stop")
+            .Key("name").Value(stop.stop_name_)
+            .Key("latitude").Value(stop.coordinates_.lat)
+            .Key("longitude").Value(stop.coordinates_.lng)
+            .Key("road_distances").StartDict();
+        for (const auto & [name, distance] : stop.distances_) {
+            writer.Key(name).Value(static_cast<int>(distance));
+        }
+        writer.EndDict().EndDict();
+    }
+    for (const domain::BUS & bus : buses) {
+        writer.StartDict()
+            .Key("type").Value("Bus")
+            .Key("name").Value(bus.bus_id_)
+            .Key("stops").StartArray();
+        for (const std::string & name : bus.stops_) {
+            writer.Value(name);
+        }
+        writer.EndArray()
+            .Key("is_roundtrip").Value(bus.is_round_trip_)
+            .EndDict();
+    }
+    writer.EndArray()
+        .Key("routing_settings").StartDict()
+            .Key("bus_velocity").Value(40)
+            .Key("bus_wait_time").Value(6)
+        .EndDict()
+        .Key("render_settings").StartDict()
+            .Key("width").Value(1200.0)
+            .Key("height").Value(1200.0)
+            .Key("padding").Value(50.0)
+            .Key("stop_radius").Value(5.0)
+            .Key("line_width").Value(14.0)
+            .Key("bus_label_font_size").Value(20)
+            .Key("bus_label_offset").StartArray().Value(7.0).Value(15.0).EndArray()
+            .Key("stop_label_font_size").Value(20)
+            .Key("stop_label_offset").StartArray().Value(7.0).Value(-3.0).EndArray()
+            .Key("underlayer_color").StartArray().Value(255).Value(255).Value(255).Value(0.85).EndArray()
+            .Key("underlayer_width").Value(3.0)
+            .Key("color_palette").StartArray().Value("green").Value("red").EndArray()
+        .EndDict()
+        .Key("serialization_settings").StartDict()
+            .Key("file").Value("transport_catalogue.db")
+        .EndDict()
+    .EndDict();
+}
+
+void WriteSyntheticRequestsJson(const CityParams & params, const RequestMix & mix, std::ostream & out) {
+    // свой генератор, чтобы запросы не зависели от того, строился ли город
+    std::mt19937 rng(params.seed + 1);
+    const size_t total_weight = mix.bus + mix.stop + mix.route + mix.map;
+
+    json::Writer writer(out);
+    writer.StartDict()
+        .Key("stat_requests").StartArray();
+    for (size_t i = 0; i < mix.count && total_weight > 0; ++i) {
+        size_t pick = rng() % total_weight;
+        writer.StartDict()
+            .Key("id").Value(static_cast<int>(i));
+        if (pick < mix.bus) {
+            writer.Key("type").Value("Bus")
+                .Key("name").Value(std::to_string(rng() % params.bus_count));
+        } else if ((pick -= mix.bus) < mix.stop) {
+            writer.Key("type").Value("Stop")
+                .Key("name").Value(StopName(rng() % params.stop_count));
+        } else if ((pick -= mix.stop) < mix.route) {
+            const size_t from = rng() % params.stop_count;
+            const size_t to = rng() % params.stop_count;
+            writer.Key("type").Value("Route")
+                .Key("from").Value(StopName(from))
+                .Key("to").Value(StopName(to));
+        } else {
+            writer.Key("type").Value("Map");
+        }
+        writer.EndDict();
+    }
+    writer.EndArray()
+    .EndDict();
+}
+
+} // namespace bench
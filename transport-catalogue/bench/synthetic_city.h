@@ -0,0 +1,41 @@
+#pragma once
+
+#include "domain.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+namespace bench {
+
+// параметры синтетического города
+struct CityParams {
+    size_t stop_count = 2000;
+    size_t bus_count = 200;
+    size_t route_length = 30; // число остановок маршрута без учета замыкания кольца
+    size_t neighbor_count = 3; // число заданных расстояний от каждой остановки
+    double ring_share = 0.5; // доля кольцевых маршрутов, они равномерно перемежаются с прочими
+    uint32_t seed = 1;
+};
+
+// состав запросов к синтетическому городу, веса типов запросов
+struct RequestMix {
+    size_t count = 10'000;
+    size_t bus = 40;
+    size_t stop = 40;
+    size_t route = 19;
+    size_t map = 1;
+};
+
+// детерминированно генерирует остановки и маршруты города: одинаковые
+// параметры всегда дают одинаковые данные.
+void MakeSyntheticCity(const CityParams & params, domain::STOPS & stops, domain::BUSES & buses);
+
+// тот же город в виде входного документа make_base (base_requests и настройки)
+void WriteSyntheticCityJson(const CityParams & params, std::ostream & out);
+
+// запросы к городу в виде входного документа process_requests (только stat_requests).
+// имена берутся из уже существующих остановок и маршрутов
+void WriteSyntheticRequestsJson(const CityParams & params, const RequestMix & mix, std::ostream & out);
+
+} // namespace bench
@@ -0,0 +1,491 @@
+#pragma once
+
+#include "graph.h"
+#include "metrics.h"
+#include "router.h"
+#include "scratch_pool.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+// Маршрутизатор на основе иерархии сжатия (contraction hierarchies).
+//
+// При подготовке вершины по очереди "сжимаются" в порядке важности: для
+// каждой пары соседей u -> v -> w, кратчайший путь между которыми проходит
+// через v, добавляется ребро-сокращение u -> w. Запрос выполняется
+// двунаправленным поиском Дейкстры, который идет только вверх по рангам,
+// а найденные сокращения раскрываются обратно в исходные EdgeId графа.
+// Запросы можно выполнять из нескольких потоков одновременно.
+template <typename Weight>
+class ContractionHierarchy {
+private:
+    using Graph = DirectedWeightedGraph<Weight>;
+
+public:
+    using RouteInfo = typename Router<Weight>::RouteInfo;
+
+    // ребро-сокращение, заменяющее путь first -> second. идентификаторы
+    // сокращений продолжают нумерацию ребер исходного графа.
+    struct Shortcut {
+        VertexId from;
+        VertexId to;
+        Weight weight;
+        EdgeId first;
+        EdgeId second;
+    };
+
+    // результат подготовки, который можно сохранить и загрузить повторно
+    struct Hierarchy {
+        std::vector<size_t> ranks;
+        std::vector<Shortcut> shortcuts;
+    };
+
+    explicit ContractionHierarchy(const Graph& graph);
+    ContractionHierarchy(const Graph& graph, Hierarchy hierarchy);
+
+    const Hierarchy& GetHierarchy() const {
+        return hierarchy_;
+    }
+
+    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const;
+
+private:
+    struct SearchEdge {
+        VertexId to;
+        Weight weight;
+        EdgeId id;
+    };
+
+    struct QueueItem {
+        Weight weight;
+        VertexId vertex;
+
+        bool operator>(const QueueItem& other) const {
+            return weight > other.weight;
+        }
+    };
+
+    // рабочие массивы поиска в одном направлении, данные вершины
+    // действительны только при совпадении метки с номером поиска
+    struct Direction {
+        std::vector<Weight> weights;
+        std::vector<EdgeId> prev_edges;
+        std::vector<uint32_t> stamps;
+        std::vector<QueueItem> heap;
+        uint32_t current_stamp = 0;
+    };
+
+    // рабочие массивы одного запроса, берутся из пула
+    struct Scratch {
+        Direction forward;
+        Direction backward;
+    };
+
+    static Hierarchy Contract(const Graph& graph);
+
+    void BuildSearchGraph();
+
+    static bool IsReached(const Direction& direction, VertexId vertex) {
+        return direction.stamps[vertex] == direction.current_stamp;
+    }
+
+    static void Push(Direction& direction, VertexId vertex, Weight weight, EdgeId prev_edge) {
+        direction.stamps[vertex] = direction.current_stamp;
+        direction.weights[vertex] = weight;
+        direction.prev_edges[vertex] = prev_edge;
+        direction.heap.push_back({weight, vertex});
+        std::push_heap(direction.heap.begin(), direction.heap.end(), std::greater<QueueItem>{});
+    }
+
+    const Shortcut& GetShortcut(EdgeId edge_id) const {
+        return hierarchy_.shortcuts[edge_id - graph_.GetEdgeCount()];
+    }
+
+    VertexId GetEdgeFrom(EdgeId edge_id) const {
+        return edge_id < graph_.GetEdgeCount() ? graph_.GetEdge(edge_id).from : GetShortcut(edge_id).from;
+    }
+
+    VertexId GetEdgeTo(EdgeId edge_id) const {
+        return edge_id < graph_.GetEdgeCount() ? graph_.GetEdge(edge_id).to : GetShortcut(edge_id).to;
+    }
+
+    void UnpackEdge(EdgeId edge_id, std::vector<EdgeId>& edges) const;
+
+    static constexpr Weight ZERO_WEIGHT{};
+    static constexpr EdgeId NO_EDGE = std::numeric_limits<EdgeId>::max();
+    // сколько вершин может просмотреть поиск свидетеля, прежде чем
+    // сокращение будет добавлено без доказательства его необходимости
+    static constexpr size_t WITNESS_SETTLE_LIMIT = 500;
+    // то же для оценки приоритета вершины: оценка может быть грубой
+    static constexpr size_t SIMULATION_SETTLE_LIMIT = 50;
+
+    const Graph& graph_;
+    Hierarchy hierarchy_;
+
+    // ребра, ведущие вверх по рангу: из вершины (прямой поиск) и в вершину (обратный)
+    std::vector<size_t> up_offsets_;
+    std::vector<SearchEdge> up_edges_;
+    std::vector<size_t> down_offsets_;
+    std::vector<SearchEdge> down_edges_;
+
+    mutable ScratchPool<Scratch> scratch_pool_;
+};
+
+template <typename Weight>
+ContractionHierarchy<Weight>::ContractionHierarchy(const Graph& graph)
+    : ContractionHierarchy(graph, Contract(graph))
+{}
+
+template <typename Weight>
+ContractionHierarchy<Weight>::ContractionHierarchy(const Graph& graph, Hierarchy hierarchy)
+    : graph_(graph)
+    , hierarchy_(std::move(hierarchy))
+{
+    if (hierarchy_.ranks.size() != graph.GetVertexCount()) {
+        throw std::invalid_argument("Hierarchy doesn't match the graph");
+    }
+    BuildSearchGraph();
+}
+
+template <typename Weight>
+typename ContractionHierarchy<Weight>::Hierarchy
+ContractionHierarchy<Weight>::Contract(const Graph& graph) {
+    const size_t vertex_count = graph.GetVertexCount();
+    const EdgeId edge_count = graph.GetEdgeCount();
+
+    // рабочий граф, из которого удаляются сжатые вершины. между парой вершин
+    // хранится только самое легкое ребро.
+    std::vector<std::vector<SearchEdge>> out(vertex_count);
+    std::vector<std::vector<SearchEdge>> in(vertex_count);
+    auto add_work_edge = [&out, &in](VertexId from, VertexId to, Weight weight, EdgeId id) {
+        for (SearchEdge& edge : out[from]) {
+            if (edge.to == to) {
+                if (weight < edge.weight) {
+                    edge.weight = weight;
+                    edge.id = id;
+                    for (SearchEdge& back : in[to]) {
+                        if (back.to == from) {
+                            back.weight = weight;
+                            back.id = id;
+                            break;
+                        }
+                    }
+                }
+                return;
+            }
+        }
+        out[from].push_back({to, weight, id});
+        in[to].push_back({from, weight, id});
+    };
+    for (EdgeId edge_id = 0; edge_id < edge_count; ++edge_id) {
+        const auto& edge = graph.GetEdge(edge_id);
+        if (edge.weight < ZERO_WEIGHT) {
+            throw std::domain_error("Edges' weights should be non-negative");
+        }
+        if (edge.from != edge.to) {
+            add_work_edge(edge.from, edge.to, edge.weight, edge_id);
+        }
+    }
+
+    Hierarchy result;
+    std::vector<bool> contracted(vertex_count, false);
+    std::vector<size_t> deleted_neighbors(vertex_count, 0);
+
+    // поиск свидетеля: ограниченный поиск Дейкстры от source в рабочем графе
+    // без вершины skip. метки позволяют не очищать массивы между поисками.
+    std::vector<Weight> witness_weights(vertex_count);
+    std::vector<uint32_t> witness_stamps(vertex_count, 0);
+    uint32_t witness_stamp = 0;
+    std::vector<QueueItem> heap;
+    auto witness_search = [&](VertexId source, VertexId skip, Weight limit, size_t settle_limit) {
+        ++witness_stamp;
+        heap.clear();
+        witness_stamps[source] = witness_stamp;
+        witness_weights[source] = ZERO_WEIGHT;
+        heap.push_back({ZERO_WEIGHT, source});
+        size_t settled = 0;
+        while (!heap.empty() && settled < settle_limit) {
+            std::pop_heap(heap.begin(), heap.end(), std::greater<QueueItem>{});
+            const QueueItem item = heap.back();
+            heap.pop_back();
+            if (item.weight > witness_weights[item.vertex]) {
+                continue;
+            }
+            if (item.weight > limit) {
+                break;
+            }
+            ++settled;
+            for (const SearchEdge& edge : out[item.vertex]) {
+                if (edge.to == skip || contracted[edge.to]) {
+                    continue;
+                }
+                const Weight candidate_weight = item.weight + edge.weight;
+                if (witness_stamps[edge.to] != witness_stamp || candidate_weight < witness_weights[edge.to]) {
+                    witness_stamps[edge.to] = witness_stamp;
+                    witness_weights[edge.to] = candidate_weight;
+                    heap.push_back({candidate_weight, edge.to});
+                    std::push_heap(heap.begin(), heap.end(), std::greater<QueueItem>{});
+                }
+            }
+        }
+    };
+
+    // сжимаем вершину либо только считаем, сколько сокращений для этого нужно
+    auto contract_vertex = [&](VertexId vertex, bool simulate) {
+        size_t shortcut_count = 0;
+        for (const SearchEdge& in_edge : in[vertex]) {
+            const VertexId from = in_edge.to;
+            if (contracted[from]) {
+                continue;
+            }
+            Weight limit = ZERO_WEIGHT;
+            for (const SearchEdge& out_edge : out[vertex]) {
+                if (!contracted[out_edge.to] && out_edge.to != from) {
+                    limit = std::max(limit, in_edge.weight + out_edge.weight);
+                }
+            }
+            witness_search(from, vertex, limit, simulate ? SIMULATION_SETTLE_LIMIT : WITNESS_SETTLE_LIMIT);
+            for (const SearchEdge& out_edge : out[vertex]) {
+                const VertexId to = out_edge.to;
+                if (contracted[to] || to == from) {
+                    continue;
+                }
+                const Weight shortcut_weight = in_edge.weight + out_edge.weight;
+                if (witness_stamps[to] == witness_stamp && !(shortcut_weight < witness_weights[to])) {
+                    continue; // есть путь не тяжелее в обход вершины
+                }
+                ++shortcut_count;
+                if (!simulate) {
+                    const EdgeId shortcut_id = edge_count + result.shortcuts.size();
+                    result.shortcuts.push_back({from, to, shortcut_weight, in_edge.id, out_edge.id});
+                    add_work_edge(from, to, shortcut_weight, shortcut_id);
+                }
+            }
+        }
+        return shortcut_count;
+    };
+
+    auto priority = [&](VertexId vertex) {
+        size_t removed = 0;
+        for (const SearchEdge& edge : in[vertex]) {
+            removed += contracted[edge.to] ? 0 : 1;
+        }
+        for (const SearchEdge& edge : out[vertex]) {
+            removed += contracted[edge.to] ? 0 : 1;
+        }
+        const size_t added = contract_vertex(vertex, true);
+        return static_cast<long long>(added) - static_cast<long long>(removed)
+            + static_cast<long long>(deleted_neighbors[vertex]);
+    };
+
+    // очередь вершин по возрастанию приоритета с ленивым обновлением
+    using Candidate = std::pair<long long, VertexId>;
+    std::vector<Candidate> queue;
+    queue.reserve(vertex_count);
+    for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+        queue.push_back({priority(vertex), vertex});
+    }
+    std::make_heap(queue.begin(), queue.end(), std::greater<Candidate>{});
+
+    result.ranks.assign(vertex_count, 0);
+    size_t next_rank = 0;
+    while (!queue.empty()) {
+        std::pop_heap(queue.begin(), queue.end(), std::greater<Candidate>{});
+        const VertexId vertex = queue.back().second;
+        queue.pop_back();
+
+        const long long actual_priority = priority(vertex);
+        if (!queue.empty() && actual_priority > queue.front().first) {
+            queue.push_back({actual_priority, vertex});
+            std::push_heap(queue.begin(), queue.end(), std::greater<Candidate>{});
+            continue;
+        }
+
+        contract_vertex(vertex, false);
+        contracted[vertex] = true;
+        result.ranks[vertex] = next_rank++;
+        // убираем сжатую вершину из списков соседей
+        auto is_contracted = [vertex](const SearchEdge& edge) { return edge.to == vertex; };
+        for (const SearchEdge& edge : in[vertex]) {
+            ++deleted_neighbors[edge.to];
+            auto& edges = out[edge.to];
+            edges.erase(std::remove_if(edges.begin(), edges.end(), is_contracted), edges.end());
+        }
+        for (const SearchEdge& edge : out[vertex]) {
+            ++deleted_neighbors[edge.to];
+            auto& edges = in[edge.to];
+            edges.erase(std::remove_if(edges.begin(), edges.end(), is_contracted), edges.end());
+        }
+        std::vector<SearchEdge>().swap(in[vertex]);
+        std::vector<SearchEdge>().swap(out[vertex]);
+    }
+    return result;
+}
+
+template <typename Weight>
+void ContractionHierarchy<Weight>::BuildSearchGraph() {
+    const size_t vertex_count = graph_.GetVertexCount();
+    const EdgeId total_edges = graph_.GetEdgeCount() + hierarchy_.shortcuts.size();
+    const auto& ranks = hierarchy_.ranks;
+
+    up_offsets_.assign(vertex_count + 1, 0);
+    down_offsets_.assign(vertex_count + 1, 0);
+    for (EdgeId edge_id = 0; edge_id < total_edges; ++edge_id) {
+        const VertexId from = GetEdgeFrom(edge_id);
+        const VertexId to = GetEdgeTo(edge_id);
+        if (ranks[from] < ranks[to]) {
+            ++up_offsets_[from + 1];
+        } else if (ranks[from] > ranks[to]) {
+            ++down_offsets_[to + 1];
+        }
+    }
+    for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+        up_offsets_[vertex + 1] += up_offsets_[vertex];
+        down_offsets_[vertex + 1] += down_offsets_[vertex];
+    }
+
+    up_edges_.resize(up_offsets_.back());
+    down_edges_.resize(down_offsets_.back());
+    std::vector<size_t> up_fill(up_offsets_.begin(), up_offsets_.end() - 1);
+    std::vector<size_t> down_fill(down_offsets_.begin(), down_offsets_.end() - 1);
+    for (EdgeId edge_id = 0; edge_id < total_edges; ++edge_id) {
+        const VertexId from = GetEdgeFrom(edge_id);
+        const VertexId to = GetEdgeTo(edge_id);
+        const Weight weight = edge_id < graph_.GetEdgeCount()
+                            ? graph_.GetEdge(edge_id).weight
+                            : GetShortcut(edge_id).weight;
+        if (ranks[from] < ranks[to]) {
+            up_edges_[up_fill[from]++] = {to, weight, edge_id};
+        } else if (ranks[from] > ranks[to]) {
+            down_edges_[down_fill[to]++] = {from, weight, edge_id};
+        }
+    }
+}
+
+template <typename Weight>
+void ContractionHierarchy<Weight>::UnpackEdge(EdgeId edge_id, std::vector<EdgeId>& edges) const {
+    std::vector<EdgeId> stack{edge_id};
+    while (!stack.empty()) {
+        const EdgeId current = stack.back();
+        stack.pop_back();
+        if (current < graph_.GetEdgeCount()) {
+            edges.push_back(current);
+        } else {
+            const Shortcut& shortcut = GetShortcut(current);
+            stack.push_back(shortcut.second);
+            stack.push_back(shortcut.first);
+        }
+    }
+}
+
+template <typename Weight>
+std::optional<typename ContractionHierarchy<Weight>::RouteInfo>
+ContractionHierarchy<Weight>::BuildRoute(VertexId from, VertexId to) const {
+    const size_t vertex_count = graph_.GetVertexCount();
+    if (from >= vertex_count || to >= vertex_count) {
+        throw std::out_of_range("vertex id is out of range");
+    }
+    auto lease = scratch_pool_.Acquire([vertex_count](Scratch& scratch) {
+        for (Direction* direction : {&scratch.forward, &scratch.backward}) {
+            direction->weights.resize(vertex_count);
+            direction->prev_edges.resize(vertex_count, NO_EDGE);
+            direction->stamps.resize(vertex_count, 0);
+        }
+    });
+    Direction& forward = lease->forward;
+    Direction& backward = lease->backward;
+    for (Direction* direction : {&forward, &backward}) {
+        if (++direction->current_stamp == 0) {
+            // счетчик поисков переполнился: сбрасываем метки один раз
+            std::fill(direction->stamps.begin(), direction->stamps.end(), 0);
+            direction->current_stamp = 1;
+        }
+        direction->heap.clear();
+    }
+
+    std::optional<Weight> best_weight;
+    VertexId meeting_vertex = from;
+    Push(forward, from, ZERO_WEIGHT, NO_EDGE);
+    Push(backward, to, ZERO_WEIGHT, NO_EDGE);
+
+    size_t relaxations = 0;
+    auto step = [&best_weight, &meeting_vertex, &relaxations](Direction& direction, const Direction& opposite,
+                                                      const std::vector<size_t>& offsets,
+                                                      const std::vector<SearchEdge>& edges) {
+        std::pop_heap(direction.heap.begin(), direction.heap.end(), std::greater<QueueItem>{});
+        const QueueItem item = direction.heap.back();
+        direction.heap.pop_back();
+        if (item.weight > direction.weights[item.vertex]) {
+            return;
+        }
+        if (IsReached(opposite, item.vertex)) {
+            const Weight candidate_weight = item.weight + opposite.weights[item.vertex];
+            if (!best_weight || candidate_weight < *best_weight) {
+                best_weight = candidate_weight;
+                meeting_vertex = item.vertex;
+            }
+        }
+        for (size_t i = offsets[item.vertex]; i < offsets[item.vertex + 1]; ++i) {
+            const SearchEdge& edge = edges[i];
+            const Weight candidate_weight = item.weight + edge.weight;
+            if (!IsReached(direction, edge.to) || candidate_weight < direction.weights[edge.to]) {
+                Push(direction, edge.to, candidate_weight, edge.id);
+                ++relaxations;
+            }
+        }
+    };
+
+    // поиск в направлении прекращается, когда его очередь не может улучшить ответ
+    auto is_active = [&best_weight](const Direction& direction) {
+        return !direction.heap.empty() && (!best_weight || direction.heap.front().weight < *best_weight);
+    };
+    while (true) {
+        const bool forwardactive = is_active(forward);
+        const bool backwardactive = is_active(backward);
+        if (!forwardactive && !backwardactive) {
+            break;
+        }
+        if (forwardactive && (!backwardactive
+                               || !(backward.heap.front().weight < forward.heap.front().weight))) {
+            step(forward, backward, up_offsets_, up_edges_);
+        } else {
+            step(backward, forward, down_offsets_, down_edges_);
+        }
+    }
+    METRICS_ADD(metrics::Counter::CH_RELAXATIONS, relaxations);
+    if (!best_weight) {
+        return std::nullopt;
+    }
+
+    // собираем путь from -> meeting_vertex, затем meeting_vertex -> to
+    std::vector<EdgeId> path;
+    for (EdgeId edge_id = forward.prev_edges[meeting_vertex];
+         edge_id != NO_EDGE;
+         edge_id = forward.prev_edges[GetEdgeFrom(edge_id)])
+    {
+        path.push_back(edge_id);
+    }
+    std::reverse(path.begin(), path.end());
+    for (EdgeId edge_id = backward.prev_edges[meeting_vertex];
+         edge_id != NO_EDGE;
+         edge_id = backward.prev_edges[GetEdgeTo(edge_id)])
+    {
+        path.push_back(edge_id);
+    }
+
+    std::vector<EdgeId> edges;
+    for (const EdgeId edge_id : path) {
+        UnpackEdge(edge_id, edges);
+    }
+    return RouteInfo{*best_weight, std::move(edges)};
+}
+
+}  // namespace graph
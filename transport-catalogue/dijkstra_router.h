@@ -0,0 +1,249 @@
+#pragma once
+
+#include "graph.h"
+#include "metrics.h"
+#include "router.h"
+#include "scratch_pool.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+// Маршрутизатор, который отвечает на каждый запрос поиском Дейкстры из
+// вершины from с остановкой при достижении to. В отличие от Router ничего
+// не предвычисляет и не держит матрицу V×V: память O(V + E), а рабочие
+// массивы поиска переиспользуются между запросами без очистки. Обходит
+// неизменяемый граф в формате CSR. Запросы можно выполнять из нескольких
+// потоков одновременно: каждый берет свои рабочие массивы из пула.
+// BuildRoutes() отвечает одним поиском на запросы с общей вершиной from.
+template <typename Weight>
+class DijkstraRouter {
+private:
+    using Graph = CsrGraph<Weight>;
+
+public:
+    using RouteInfo = typename Router<Weight>::RouteInfo;
+
+    explicit DijkstraRouter(const Graph& graph);
+
+    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const;
+
+    // пути из from во все вершины targets по одному дереву кратчайших путей.
+    // поиск останавливается, когда достигнуты все targets. i-й элемент
+    // результата - путь до targets[i] или nullopt, если пути нет
+    std::vector<std::optional<RouteInfo>> BuildRoutes(VertexId from, const std::vector<VertexId>& targets) const;
+
+private:
+    struct QueueItem {
+        Weight weight;
+        VertexId vertex;
+
+        bool operator>(const QueueItem& other) const {
+            return weight > other.weight;
+        }
+    };
+
+    // рабочие массивы поиска. данные вершины действительны только если её
+    // метка совпадает с номером текущего поиска, поэтому между запросами
+    // массивы не требуется обнулять.
+    struct Scratch {
+        std::vector<Weight> weights;
+        std::vector<EdgeId> prev_edges;
+        std::vector<VertexId> prev_vertices;
+        std::vector<uint32_t> stamps;
+        std::vector<uint32_t> target_stamps; // вершина - еще не достигнутая цель BuildRoutes()
+        std::vector<QueueItem> heap;
+        uint32_t current_stamp = 0;
+    };
+
+    static void StartSearch(Scratch& scratch) {
+        if (++scratch.current_stamp == 0) {
+            // счетчик поисков переполнился: сбрасываем метки один раз
+            std::fill(scratch.stamps.begin(), scratch.stamps.end(), 0);
+            std::fill(scratch.target_stamps.begin(), scratch.target_stamps.end(), 0);
+            scratch.current_stamp = 1;
+        }
+        scratch.heap.clear();
+    }
+
+    static bool IsReached(const Scratch& scratch, VertexId vertex) {
+        return scratch.stamps[vertex] == scratch.current_stamp;
+    }
+
+    static void Push(Scratch& scratch, VertexId vertex, Weight weight, EdgeId prev_edge, VertexId prev_vertex) {
+        scratch.stamps[vertex] = scratch.current_stamp;
+        scratch.weights[vertex] = weight;
+        scratch.prev_edges[vertex] = prev_edge;
+        scratch.prev_vertices[vertex] = prev_vertex;
+        scratch.heap.push_back({weight, vertex});
+        std::push_heap(scratch.heap.begin(), scratch.heap.end(), std::greater<QueueItem>{});
+    }
+
+    typename ScratchPool<Scratch>::Lease AcquireScratch() const;
+
+    // достаем из очереди ближайшую запись. ложь - запись устарела
+    static bool PopVertex(Scratch& scratch, QueueItem& item);
+    // улучшаем расстояния до соседей вершины, relaxations - их счетчик
+    void RelaxEdges(Scratch& scratch, const QueueItem& item, size_t& relaxations) const;
+
+    // путь до достигнутой поиском вершины to по цепочке предшественников
+    static RouteInfo ExtractRoute(const Scratch& scratch, VertexId to);
+
+    static constexpr Weight ZERO_WEIGHT{};
+    static constexpr EdgeId NO_EDGE = std::numeric_limits<EdgeId>::max();
+    const Graph& graph_;
+    mutable ScratchPool<Scratch> scratch_pool_;
+};
+
+template <typename Weight>
+DijkstraRouter<Weight>::DijkstraRouter(const Graph& graph)
+    : graph_(graph)
+{
+    for (size_t slot = 0, edge_count = graph.GetEdgeCount(); slot < edge_count; ++slot) {
+        if (graph.GetWeight(slot) < ZERO_WEIGHT) {
+            throw std::domain_error("Edges' weights should be non-negative");
+        }
+    }
+}
+
+template <typename Weight>
+typename ScratchPool<typename DijkstraRouter<Weight>::Scratch>::Lease DijkstraRouter<Weight>::AcquireScratch() const {
+    const size_t vertex_count = graph_.GetVertexCount();
+    return scratch_pool_.Acquire([vertex_count](Scratch& scratch) {
+        scratch.weights.resize(vertex_count);
+        scratch.prev_edges.resize(vertex_count, NO_EDGE);
+        scratch.prev_vertices.resize(vertex_count, 0);
+        scratch.stamps.resize(vertex_count, 0);
+        scratch.target_stamps.resize(vertex_count, 0);
+    });
+}
+
+template <typename Weight>
+bool DijkstraRouter<Weight>::PopVertex(Scratch& scratch, QueueItem& item) {
+    std::pop_heap(scratch.heap.begin(), scratch.heap.end(), std::greater<QueueItem>{});
+    item = scratch.heap.back();
+    scratch.heap.pop_back();
+    return item.weight <= scratch.weights[item.vertex]; // иначе устаревшая запись очереди
+}
+
+template <typename Weight>
+void DijkstraRouter<Weight>::RelaxEdges(Scratch& scratch, const QueueItem& item, size_t& relaxations) const {
+    for (size_t slot = graph_.EdgesBegin(item.vertex), end = graph_.EdgesEnd(item.vertex); slot < end; ++slot) {
+        const VertexId target = graph_.GetTarget(slot);
+        const Weight candidate_weight = item.weight + graph_.GetWeight(slot);
+        if (!IsReached(scratch, target) || candidate_weight < scratch.weights[target]) {
+            Push(scratch, target, candidate_weight, graph_.GetEdgeId(slot), item.vertex);
+            ++relaxations;
+        }
+    }
+}
+
+template <typename Weight>
+typename DijkstraRouter<Weight>::RouteInfo DijkstraRouter<Weight>::ExtractRoute(const Scratch& scratch, VertexId to) {
+    std::vector<EdgeId> edges;
+    for (VertexId vertex = to; scratch.prev_edges[vertex] != NO_EDGE; vertex = scratch.prev_vertices[vertex]) {
+        edges.push_back(scratch.prev_edges[vertex]);
+    }
+    std::reverse(edges.begin(), edges.end());
+    return RouteInfo{scratch.weights[to], std::move(edges)};
+}
+
+template <typename Weight>
+std::optional<typename DijkstraRouter<Weight>::RouteInfo>
+DijkstraRouter<Weight>::BuildRoute(VertexId from, VertexId to) const {
+    const size_t vertex_count = graph_.GetVertexCount();
+    if (from >= vertex_count || to >= vertex_count) {
+        throw std::out_of_range("vertex id is out of range");
+    }
+
+    auto lease = AcquireScratch();
+    Scratch& scratch = *lease;
+
+    StartSearch(scratch);
+    Push(scratch, from, ZERO_WEIGHT, NO_EDGE, from);
+    bool found = false;
+    size_t relaxations = 0;
+    QueueItem item;
+    while (!scratch.heap.empty()) {
+        if (!PopVertex(scratch, item)) {
+            continue;
+        }
+        if (item.vertex == to) {
+            found = true;
+            break;
+        }
+        RelaxEdges(scratch, item, relaxations);
+    }
+    METRICS_ADD(metrics::Counter::DIJKSTRA_RELAXATIONS, relaxations);
+    if (!found) {
+        return std::nullopt;
+    }
+    return ExtractRoute(scratch, to);
+}
+
+template <typename Weight>
+std::vector<std::optional<typename DijkstraRouter<Weight>::RouteInfo>>
+DijkstraRouter<Weight>::BuildRoutes(VertexId from, const std::vector<VertexId>& targets) const {
+    const size_t vertex_count = graph_.GetVertexCount();
+    if (from >= vertex_count) {
+        throw std::out_of_range("vertex id is out of range");
+    }
+    for (VertexId to : targets) {
+        if (to >= vertex_count) {
+            throw std::out_of_range("vertex id is out of range");
+        }
+    }
+    if (targets.empty()) {
+        return {};
+    }
+
+    auto lease = AcquireScratch();
+    Scratch& scratch = *lease;
+
+    StartSearch(scratch);
+    // цели помечаем номером текущего поиска, повторы считаем один раз
+    size_t remaining = 0;
+    for (VertexId to : targets) {
+        if (scratch.target_stamps[to] != scratch.current_stamp) {
+            scratch.target_stamps[to] = scratch.current_stamp;
+            ++remaining;
+        }
+    }
+    Push(scratch, from, ZERO_WEIGHT, NO_EDGE, from);
+    size_t relaxations = 0;
+    QueueItem item;
+    while (!scratch.heap.empty()) {
+        if (!PopVertex(scratch, item)) {
+            continue;
+        }
+        if (scratch.target_stamps[item.vertex] == scratch.current_stamp) {
+            scratch.target_stamps[item.vertex] = 0;
+            if (--remaining == 0) {
+                break;
+            }
+        }
+        RelaxEdges(scratch, item, relaxations);
+    }
+    METRICS_ADD(metrics::Counter::DIJKSTRA_RELAXATIONS, relaxations);
+
+    // вершина, до которой поиск дошел, достигнута по кратчайшему пути,
+    // только если она уже выбрана из очереди, а выбраны все цели, кроме
+    // недостижимых - их метка цели осталась
+    std::vector<std::optional<RouteInfo>> result(targets.size());
+    for (size_t i = 0; i < targets.size(); ++i) {
+        const VertexId to = targets[i];
+        if (IsReached(scratch, to) && scratch.target_stamps[to] != scratch.current_stamp) {
+            result[i] = ExtractRoute(scratch, to);
+        }
+    }
+    return result;
+}
+
+}  // namespace graph
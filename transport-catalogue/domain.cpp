@@ -1,8 +1,14 @@
 #include "domain.h"
 #include "transport_catalogue.h"
 #include "request_handler.h"
+#include "metrics.h"
+#include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <cmath>
+#include <exception>
+#include <thread>
+#include <unordered_map>
 
 using namespace tcatalogue;
 
@@ -10,28 +16,33 @@ namespace domain {
 
 // заполняем транспортную базу информацией из массивов stops и buses.
 void FillDatabase(tcatalogue::TransportCatalogue & db, const STOPS & stops, const BUSES & buses) {
+    METRICS_SCOPE(metrics::Timer::FILL_DATABASE);
     using LenghtsList = std::list<std::pair<std::string, size_t>>;
-    std::unordered_map<std::string, LenghtsList> lengths_for_stop;
+    // расстояния берем из последнего непустого списка остановки
+    std::vector<const LenghtsList*> lengths_for_stop;
     for (auto & stop : stops) {
-        db.AddStop(stop.stop_name_, stop.coordinates_);
+        const Stop* pstop = db.AddStop(stop.stop_name_, stop.coordinates_);
+        if (pstop->index >= lengths_for_stop.size()) {
+            lengths_for_stop.resize(pstop->index + 1, nullptr);
+        }
         if (stop.distances_.size() == 0) {
             // WARN() << __FUNCTION__ << name << " is empty" << std::endl;
         } else {
-            lengths_for_stop[stop.stop_name_] = std::move(stop.distances_);
+            lengths_for_stop[pstop->index] = &stop.distances_;
         }
     }
     // process bus information
     for (const BUS & bus : buses) {
         db.AddBus(bus.bus_id_, bus.stops_, bus.is_round_trip_);
     }
-    // process distances between stops information
-    for (auto & [stop_name, lenghts] : lengths_for_stop) {
-        const Stop* pstopA = db.GetStop(stop_name);
-        if (pstopA == nullptr) {
-            // WARN() << __FUNCTION__ << " [A] '" << stop_name << "' not found." << std::endl;
+    // process distances between stops information. остановки отправления
+    // идут по порядку номеров, поэтому каталог дописывает соседей в конец
+    for (size_t index = 0; index < lengths_for_stop.size(); ++index) {
+        if (lengths_for_stop[index] == nullptr) {
             continue;
         }
-        for (auto & [other_stop_name, meters] : lenghts) {
+        const Stop* pstopA = db.GetStopByIndex(index);
+        for (auto & [other_stop_name, meters] : *lengths_for_stop[index]) {
             const Stop* pstopB = db.GetStop(other_stop_name);
             if (pstopB == nullptr) {
                 // WARN() << __FUNCTION__ << " [B] '" << other_stop_name << "' not found." << std::endl;
@@ -40,69 +51,217 @@ void FillDatabase(tcatalogue::TransportCatalogue & db, const STOPS & stops, cons
             db.SetDistanceBetween(pstopA, pstopB, meters);
         }
     }
+    db.ComputeBusStats();
+    db.ComputeStopBusNames();
 }
 
-// заполняем отклики на STAT запросы
-void FillStatResponses(const RequestHandler & handler,
-                       const STAT_REQUESTS & requests,
-                       STAT_RESPONSES & responses) {
-    responses.clear();
-    const std::string err_not_found("not found");
+static const std::string err_not_found("not found");
+
+static STAT_RESPONSE RouteResponse(int request_id, STAT_RESP_ROUTE && resp) {
+    if (resp.route == nullptr) {
+        return RESP_ERROR{request_id, err_not_found};
+    }
+    resp.request_id = request_id;
+    return std::move(resp);
+}
+
+// заполняем отклик на один STAT запрос
+static STAT_RESPONSE HandleStatRequest(const RequestHandler & handler, const STAT_REQUEST & req) {
+    if (req.IsStop()) {
+        // имена маршрутов отсортированы при заполнении каталога
+        auto opt_bus_names = handler.GetStopBusNames(req.Stop().name_);
+        if (opt_bus_names.has_value() == false) {
+            return RESP_ERROR{req.id_, err_not_found};
+        }
+        return STAT_RESP_STOP{req.id_, opt_bus_names.value()};
+    } else if (req.IsBus()){
+        const auto & bus = handler.GetBus(req.Bus().name_);
+        if (bus.stops.empty()) {
+            return RESP_ERROR{req.id_, err_not_found};
+        }
+        // показатели посчитаны при заполнении каталога или взяты из базы
+        const BusStats stats = handler.GetBusStats(bus);
+        STAT_RESP_BUS resp;
+        resp.request_id = req.id_;
+        resp.curvature         = static_cast<double>(stats.route_length) / stats.geo_length;
+        resp.route_length      = static_cast<int>(stats.route_length);
+        resp.stop_count        = static_cast<int>(stats.stop_count);
+        resp.unique_stop_count = static_cast<int>(stats.unique_stop_count);
+        return resp;
+    } else if (req.IsMap()) {
+        STAT_RESP_MAP resp;
+        resp.request_id = req.id_;
+        resp.map = handler.DrawMap();
+        return resp;
+    } else if (req.IsRoute()) {
+        STAT_RESP_ROUTE resp;
+        handler.HandleRoute(req.Route(), resp);
+        return RouteResponse(req.id_, std::move(resp));
+    }
+    assert(false); // запросы неизвестного типа отбрасываются в FillStatResponses()
+    return RESP_ERROR{req.id_, err_not_found};
+}
+
+// таймер задержки запроса его типа
+[[maybe_unused]] static metrics::Timer RequestTimer(const STAT_REQUEST & req) {
+    if (req.IsBus()) {
+        return metrics::Timer::REQUEST_BUS;
+    } else if (req.IsStop()) {
+        return metrics::Timer::REQUEST_STOP;
+    } else if (req.IsRoute()) {
+        return metrics::Timer::REQUEST_ROUTE;
+    }
+    return metrics::Timer::REQUEST_MAP;
+}
+
+// запросы известных типов в порядке следования. на запросы неизвестного
+// типа отклик не формируется
+static std::vector<const STAT_REQUEST*> IndexStatRequests(const STAT_REQUESTS & requests) {
+    std::vector<const STAT_REQUEST*> result;
+    result.reserve(requests.size());
     for (const STAT_REQUEST & req : requests) {
-        if (req.IsStop()) {
-            auto opt_stop_busses = handler.GetStopBuses(req.Stop().name_);
-            if (opt_stop_busses.has_value() == false) {
-                responses.emplace_back( RESP_ERROR{req.id_, err_not_found} );
-            } else {
-                STAT_RESP_STOP resp;
-                resp.request_id = req.id_;
-                const auto & stop_busses = opt_stop_busses.value().get();
-                if (stop_busses.size() != 0) {
-                    std::vector<std::string_view> vector_stops;
-                    vector_stops.reserve(stop_busses.size());
-                    for (auto * pbus : stop_busses) {
-                        vector_stops.push_back(pbus->id);
-                    }
-                    std::sort(vector_stops.begin(), vector_stops.end());
-                    for (const auto & bus_id : vector_stops) {
-                        resp.buses.push_back( std::string(bus_id) );
-                    }
+        if (req.IsStop() || req.IsBus() || req.IsMap() || req.IsRoute()) {
+            result.push_back(&req);
+        }
+    }
+    return result;
+}
+
+// раскладываем номера count запросов на группы запросов Route с общей
+// начальной остановкой, если обработчик отвечает на них одним поиском, и
+// остальные запросы по порядку
+static void ScheduleStatRequests(const RequestHandler & handler,
+                                 const STAT_REQUEST * const * requests, size_t count,
+                                 std::vector<size_t> & singles,
+                                 std::vector<std::vector<size_t>> & route_groups) {
+    singles.clear();
+    route_groups.clear();
+    if (!handler.GroupsRoutesByOrigin()) {
+        singles.resize(count);
+        for (size_t i = 0; i < count; ++i) {
+            singles[i] = i;
+        }
+        return;
+    }
+    std::unordered_map<std::string_view, size_t> group_of_origin;
+    for (size_t i = 0; i < count; ++i) {
+        if (!requests[i]->IsRoute()) {
+            singles.push_back(i);
+            continue;
+        }
+        auto [it, inserted] = group_of_origin.emplace(requests[i]->Route().from_, route_groups.size());
+        if (inserted) {
+            route_groups.emplace_back();
+        }
+        route_groups[it->second].push_back(i);
+    }
+    // группа из одного запроса выигрыша не дает
+    auto single_end = std::partition(route_groups.begin(), route_groups.end(),
+                                     [](const std::vector<size_t> & group) { return group.size() > 1; });
+    for (auto it = single_end; it != route_groups.end(); ++it) {
+        singles.push_back(it->front());
+    }
+    route_groups.erase(single_end, route_groups.end());
+    std::sort(singles.begin(), singles.end());
+}
+
+// отвечаем на группу запросов Route с общей начальной остановкой
+static void HandleRouteGroup(const RequestHandler & handler,
+                             const STAT_REQUEST * const * requests, const std::vector<size_t> & group,
+                             STAT_RESPONSES & responses) {
+    METRICS_SCOPE(metrics::Timer::REQUEST_ROUTE_GROUP);
+    METRICS_ADD(metrics::Counter::ROUTES_GROUPED, group.size());
+    std::vector<const STAT_REQ_ROUTE*> route_requests;
+    route_requests.reserve(group.size());
+    for (size_t i : group) {
+        route_requests.push_back(&requests[i]->Route());
+    }
+    std::vector<STAT_RESP_ROUTE> route_responses(group.size());
+    handler.HandleRoutesFrom(route_requests.data(), group.size(), route_responses.data());
+    for (size_t k = 0; k < group.size(); ++k) {
+        responses[group[k]] = RouteResponse(requests[group[k]]->id_, std::move(route_responses[k]));
+    }
+}
+
+// заполняем отклики на count запросов. запросы Route с общей начальной
+// остановкой собираются в группы, остальные делятся на небольшие блоки.
+// потоки разбирают группы и блоки по очереди, а отклик записывается на
+// место своего запроса, поэтому порядок откликов не зависит от числа потоков.
+static void FillStatResponsesRange(const RequestHandler & handler,
+                                   const STAT_REQUEST * const * requests, size_t count,
+                                   STAT_RESPONSES & responses,
+                                   size_t thread_count) {
+    responses.clear();
+    responses.resize(count);
+
+    std::vector<size_t> singles;
+    std::vector<std::vector<size_t>> route_groups;
+    ScheduleStatRequests(handler, requests, count, singles, route_groups);
+
+    // сначала группы: каждая дольше блока
+    static constexpr size_t BLOCK_SIZE = 64;
+    const size_t block_count = (singles.size() + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    const size_t task_count = route_groups.size() + block_count;
+    thread_count = std::max<size_t>(1, std::min(thread_count, task_count));
+
+    std::atomic<size_t> next_task{0};
+    std::vector<std::exception_ptr> errors(thread_count);
+    auto worker = [&](size_t worker_index) {
+        try {
+            for (size_t task = next_task++; task < task_count; task = next_task++) {
+                if (task < route_groups.size()) {
+                    HandleRouteGroup(handler, requests, route_groups[task], responses);
+                    continue;
+                }
+                const size_t block = task - route_groups.size();
+                const size_t end = std::min(singles.size(), (block + 1) * BLOCK_SIZE);
+                for (size_t k = block * BLOCK_SIZE; k < end; ++k) {
+                    const size_t i = singles[k];
+                    METRICS_SCOPE(RequestTimer(*requests[i]));
+                    responses[i] = HandleStatRequest(handler, *requests[i]);
                 }
-                responses.emplace_back( resp );
-            }
-        } else if (req.IsBus()){
-            auto bus = handler.GetBus(req.Bus().name_);
-            if (bus.stops.empty()) {
-                responses.emplace_back( RESP_ERROR{req.id_, err_not_found} );
-            } else {
-                STAT_RESP_BUS resp;
-                resp.request_id = req.id_;
-                size_t stops_on_route = (bus.is_round_trip
-                     ? bus.stops.size()
-                     : (bus.stops.size() * 2) - 1);
-                size_t unique_stops = UniqueStopsCount(bus);
-                std::pair<double, double> route_length = handler.CalculateRouteLength(bus);
-                double curvature = route_length.second / route_length.first;
-                resp.curvature         = curvature;
-                resp.route_length      = static_cast<int>(route_length.second);
-                resp.stop_count        = static_cast<int>(stops_on_route);
-                resp.unique_stop_count = static_cast<int>(unique_stops);
-                responses.emplace_back(resp);
-            }
-        } else if (req.IsMap()) {
-            STAT_RESP_MAP resp;
-            resp.request_id = req.id_;
-            resp.map = handler.DrawMap();
-            responses.emplace_back(resp);
-        } else if (req.IsRoute()) {
-            STAT_RESP_ROUTE resp;
-            if (!handler.HandleRoute(req.Route(), resp)) {
-                responses.emplace_back( RESP_ERROR{req.id_, err_not_found} );
-            } else {
-                resp.request_id = req.id_;
-                responses.emplace_back(resp);
             }
+        } catch (...) {
+            errors[worker_index] = std::current_exception();
         }
+    };
+    std::vector<std::thread> threads;
+    threads.reserve(thread_count - 1);
+    for (size_t t = 1; t < thread_count; ++t) {
+        threads.emplace_back(worker, t);
+    }
+    worker(0);
+    for (std::thread & thread : threads) {
+        thread.join();
+    }
+    for (const std::exception_ptr & error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+}
+
+// заполняем отклики на STAT запросы
+void FillStatResponses(const RequestHandler & handler,
+                       const STAT_REQUESTS & requests,
+                       STAT_RESPONSES & responses,
+                       size_t thread_count) {
+    const std::vector<const STAT_REQUEST*> indexed_requests = IndexStatRequests(requests);
+    FillStatResponsesRange(handler, indexed_requests.data(), indexed_requests.size(), responses, thread_count);
+}
+
+// выполняем STAT запросы блоками, отдавая отклики каждого блока сразу
+void ProcessStatRequests(const RequestHandler & handler,
+                         const STAT_REQUESTS & requests,
+                         size_t thread_count, size_t chunk_size,
+                         const std::function<void(const STAT_RESPONSES &)> & on_chunk) {
+    const std::vector<const STAT_REQUEST*> indexed_requests = IndexStatRequests(requests);
+    chunk_size = std::max<size_t>(1, chunk_size);
+    STAT_RESPONSES responses;
+    for (size_t begin = 0; begin < indexed_requests.size(); begin += chunk_size) {
+        const size_t count = std::min(chunk_size, indexed_requests.size() - begin);
+        FillStatResponsesRange(handler, indexed_requests.data() + begin, count, responses, thread_count);
+        on_chunk(responses);
     }
 }
 
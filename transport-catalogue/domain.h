@@ -1,6 +1,8 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <list>
 #include <unordered_set>
@@ -8,7 +10,9 @@
 #include <functional>
 #include <variant>
 #include <map>
+#include <memory>
 #include "geo.h"
+#include "ranges.h"
 
 class RequestHandler;
 
@@ -18,18 +22,43 @@ class TransportCatalogue;
 
 namespace domain {
 
+// формат файла базы
+enum class BaseFormat {
+    PROTOBUF = 0, // сообщение Catalogue
+    FLAT,         // плоская раскладка со смещениями, читается через mmap
+};
+
 struct SerializeSettings {
     std::string file;
+    bool store_map = false; // сохранять в базу отрисованную карту
+    BaseFormat format = BaseFormat::PROTOBUF; // учитывается при записи, при чтении формат определяется по файлу
+};
+
+// алгоритм поиска кратчайшего пути
+enum class RouterType {
+    FLOYD_WARSHALL = 0, // предвычисление всех пар вершин при подготовке графа
+    DIJKSTRA,           // поиск Дейкстры на каждый запрос
+    CONTRACTION_HIERARCHIES, // иерархия сжатия, строится при создании базы
+};
+
+// модель графа маршрутов
+enum class GraphModel {
+    ALL_SPANS = 0, // ребро на каждую пару остановок маршрута
+    ON_BOARD,      // цепочка вершин "в автобусе" с ребрами посадки и высадки
 };
 
 struct RoutingSettings {
     double bus_velocity;
     double bus_wait_time;
+    RouterType router_type = RouterType::FLOYD_WARSHALL;
+    GraphModel graph_model = GraphModel::ALL_SPANS;
+    size_t route_cache_kb = 16 * 1024; // кеш ответов Route, 0 - без кеша
 };
 
 struct Stop {
-    std::string name;
+    std::string_view name; // строка принадлежит каталогу
     geo::Coordinates coordinates;
+    uint32_t index = 0; // плотный номер остановки в каталоге
 };
 
 struct STOP {
@@ -41,13 +70,24 @@ using STOPS = std::list<STOP>;
 
 using BusId = std::string;
 struct Bus {
-    BusId id;
+    std::string_view id; // строка принадлежит каталогу
     bool is_round_trip;
     std::vector<Stop*> stops;
+    uint32_t index = 0; // плотный номер маршрута в каталоге
+};
+
+// показатели маршрута для запроса Bus
+struct BusStats {
+    double geo_length = 0.0;        // длина по прямой между остановками
+    uint64_t route_length = 0;      // длина по дорогам, м
+    uint32_t stop_count = 0;        // у некольцевого маршрута - туда и обратно
+    uint32_t unique_stop_count = 0;
 };
 
 using StopsList = std::list<std::string>;
-using StopBusesOpt = std::optional<std::reference_wrapper<const std::unordered_set<Bus*>>>;
+using StopBusesOpt = std::optional<std::reference_wrapper<const std::vector<Bus*>>>;
+// отсортированные имена маршрутов остановки, хранятся в каталоге
+using StopBusNames = ranges::Range<const std::string_view*>;
 
 struct BUS {
     std::string bus_id_;
@@ -167,20 +207,21 @@ struct STAT_RESP_BUS {
 };
 struct STAT_RESP_STOP {
     int request_id;
-    std::vector<std::string> buses;
+    StopBusNames buses; // ссылается на каталог, живет не дольше него
 };
 struct STAT_RESP_MAP {
     int request_id;
-    std::string map;
+    std::shared_ptr<const std::string> map; // общая для всех запросов карта
 };
 
+// имена в элементах маршрута принадлежат каталогу
 struct STAT_RESP_ROUTE_ITEM_WAIT {
-    std::string stop_name;
+    std::string_view stop_name;
     double time = 0.0;
 };
 
 struct STAT_RESP_ROUTE_ITEM_BUS {
-    std::string bus;
+    std::string_view bus;
     int span_count = 0;
     double time = 0.0;
 };
@@ -217,17 +258,25 @@ struct STAT_RESP_ROUTE_ITEM {
         return std::get<STAT_RESP_ROUTE_ITEM_BUS>(data_);
     }
 };
+struct STAT_ROUTE {
+    double total_time = 0.0;
+    std::vector<STAT_RESP_ROUTE_ITEM> items;
+};
 struct STAT_RESP_ROUTE {
     int request_id;
-    double total_time = 0.0;
-    std::list<STAT_RESP_ROUTE_ITEM> items;
+    std::shared_ptr<const STAT_ROUTE> route; // общий для запросов с той же парой остановок
 };
 
 using STAT_RESPONSE = std::variant<RESP_ERROR, STAT_RESP_BUS, STAT_RESP_STOP, STAT_RESP_MAP, STAT_RESP_ROUTE>;
-using STAT_RESPONSES = std::list<STAT_RESPONSE>;
-void FillStatResponses(const RequestHandler & handler, const STAT_REQUESTS & requests, STAT_RESPONSES & responses);
-
-std::pair<double, double> CalculateRouteLength(const tcatalogue::TransportCatalogue & db, const Bus & bus);
+using STAT_RESPONSES = std::vector<STAT_RESPONSE>;
+// отклик i соответствует запросу i. запросы выполняются в thread_count потоков
+void FillStatResponses(const RequestHandler & handler, const STAT_REQUESTS & requests, STAT_RESPONSES & responses,
+                       size_t thread_count = 1);
+// выполняем запросы блоками по chunk_size и передаем отклики каждого блока
+// в on_chunk по порядку, не дожидаясь выполнения остальных запросов
+void ProcessStatRequests(const RequestHandler & handler, const STAT_REQUESTS & requests,
+                         size_t thread_count, size_t chunk_size,
+                         const std::function<void(const STAT_RESPONSES &)> & on_chunk);
 
 size_t UniqueStopsCount(const Bus & bus);
 
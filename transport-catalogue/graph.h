@@ -26,7 +26,11 @@ private:
 public:
     DirectedWeightedGraph() = default;
     explicit DirectedWeightedGraph(size_t vertex_count);
+    // граф из готового набора ребер, номер ребра - его индекс в edges
+    DirectedWeightedGraph(size_t vertex_count, std::vector<Edge<Weight>> edges);
     EdgeId AddEdge(const Edge<Weight>& edge);
+    // резервирует место под edge_count ребер, не меняя граф
+    void ReserveEdges(size_t edge_count);
 
     size_t GetVertexCount() const;
     size_t GetEdgeCount() const;
@@ -43,6 +47,15 @@ DirectedWeightedGraph<Weight>::DirectedWeightedGraph(size_t vertex_count)
     : incidence_lists_(vertex_count) {
 }
 
+template <typename Weight>
+DirectedWeightedGraph<Weight>::DirectedWeightedGraph(size_t vertex_count, std::vector<Edge<Weight>> edges)
+    : edges_(std::move(edges))
+    , incidence_lists_(vertex_count) {
+    for (EdgeId id = 0; id < edges_.size(); ++id) {
+        incidence_lists_.at(edges_[id].from).push_back(id);
+    }
+}
+
 template <typename Weight>
 EdgeId DirectedWeightedGraph<Weight>::AddEdge(const Edge<Weight>& edge) {
     edges_.push_back(edge);
@@ -51,6 +64,11 @@ EdgeId DirectedWeightedGraph<Weight>::AddEdge(const Edge<Weight>& edge) {
     return id;
 }
 
+template <typename Weight>
+void DirectedWeightedGraph<Weight>::ReserveEdges(size_t edge_count) {
+    edges_.reserve(edge_count);
+}
+
 template <typename Weight>
 size_t DirectedWeightedGraph<Weight>::GetVertexCount() const {
     return incidence_lists_.size();
@@ -71,4 +89,66 @@ typename DirectedWeightedGraph<Weight>::IncidentEdgesRange
 DirectedWeightedGraph<Weight>::GetIncidentEdges(VertexId vertex) const {
     return ranges::AsRange(incidence_lists_.at(vertex));
 }
+
+// Неизменяемое представление графа в формате CSR (compressed sparse row).
+// Исходящие ребра вершины v занимают слоты [EdgesBegin(v), EdgesEnd(v)),
+// а цель, вес и исходный EdgeId ребра лежат в непрерывных массивах, так что
+// обход соседей не требует отдельного обращения к списку ребер.
+template <typename Weight>
+class CsrGraph {
+public:
+    CsrGraph() = default;
+    explicit CsrGraph(const DirectedWeightedGraph<Weight>& graph);
+
+    size_t GetVertexCount() const {
+        return offsets_.empty() ? 0 : offsets_.size() - 1;
+    }
+    size_t GetEdgeCount() const {
+        return targets_.size();
+    }
+
+    size_t EdgesBegin(VertexId vertex) const {
+        return offsets_[vertex];
+    }
+    size_t EdgesEnd(VertexId vertex) const {
+        return offsets_[vertex + 1];
+    }
+
+    VertexId GetTarget(size_t slot) const {
+        return targets_[slot];
+    }
+    Weight GetWeight(size_t slot) const {
+        return weights_[slot];
+    }
+    EdgeId GetEdgeId(size_t slot) const {
+        return edge_ids_[slot];
+    }
+
+private:
+    std::vector<size_t> offsets_;
+    std::vector<VertexId> targets_;
+    std::vector<Weight> weights_;
+    std::vector<EdgeId> edge_ids_;
+};
+
+template <typename Weight>
+CsrGraph<Weight>::CsrGraph(const DirectedWeightedGraph<Weight>& graph) {
+    const size_t vertex_count = graph.GetVertexCount();
+    const size_t edge_count = graph.GetEdgeCount();
+    offsets_.reserve(vertex_count + 1);
+    targets_.reserve(edge_count);
+    weights_.reserve(edge_count);
+    edge_ids_.reserve(edge_count);
+    // порядок ребер каждой вершины совпадает с порядком в списке инцидентности
+    for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+        offsets_.push_back(targets_.size());
+        for (const EdgeId edge_id : graph.GetIncidentEdges(vertex)) {
+            const auto& edge = graph.GetEdge(edge_id);
+            targets_.push_back(edge.to);
+            weights_.push_back(edge.weight);
+            edge_ids_.push_back(edge_id);
+        }
+    }
+    offsets_.push_back(targets_.size());
+}
 }  // namespace graph
\ No newline at end of file
@@ -1,8 +1,12 @@
 #include "json.h"
+#include <charconv>
 #include <stack>
+#include <string_view>
+#include <utility>
 #include "domain.h"
 
 using namespace std;
+using namespace std::literals;
 
 namespace json {
 
@@ -239,6 +243,300 @@ Node LoadNode(istream& input) {
     }
 }
 
+// Лексический разбор JSON из непрерывного буфера. В отличие от разбора
+// из потока не читает по одному символу и не копирует числа во временную
+// строку: строки без escape-последовательностей возвращаются участком буфера.
+class BufferLexer {
+public:
+    explicit BufferLexer(std::string_view text)
+        : text_(text)
+    {}
+
+    // пропускает пробельные символы и возвращает очередной символ, не извлекая его.
+    // в конце буфера возвращает '\0'
+    char PeekToken() {
+        while (pos_ < text_.size() && IsSpace(text_[pos_])) {
+            ++pos_;
+        }
+        return pos_ < text_.size() ? text_[pos_] : '\0';
+    }
+
+    // извлекает ожидаемый символ после пробелов
+    void Expect(char ch) {
+        if (PeekToken() != ch) {
+            throw ParsingError("'"s + ch + "' is expected"s);
+        }
+        ++pos_;
+    }
+
+    // извлекает ожидаемый символ, если он следующий после пробелов
+    bool Consume(char ch) {
+        if (PeekToken() != ch) {
+            return false;
+        }
+        ++pos_;
+        return true;
+    }
+
+    // строковый литерал, начиная с открывающей кавычки. если в нем нет
+    // escape-последовательностей, результат указывает в буфер, иначе - в storage
+    std::string_view ScanString(std::string & storage) {
+        Expect('"');
+        const size_t begin = pos_;
+        for (; pos_ < text_.size(); ++pos_) {
+            const char ch = text_[pos_];
+            if (ch == '"') {
+                return text_.substr(begin, pos_++ - begin);
+            } else if (ch == '\\') {
+                storage.assign(text_.substr(begin, pos_ - begin));
+                return ScanEscapedString(storage);
+            } else if (ch == '\n' || ch == '\r') {
+                throw ParsingError("Unexpected end of line"s);
+            }
+        }
+        throw ParsingError("String parsing error");
+    }
+
+    // число в формате JSON: int, если оно целое и помещается в int, иначе double
+    Number ScanNumber() {
+        const size_t begin = pos_;
+        auto read_digits = [this] {
+            if (pos_ >= text_.size() || !IsDigit(text_[pos_])) {
+                throw ParsingError("A digit is expected"s);
+            }
+            while (pos_ < text_.size() && IsDigit(text_[pos_])) {
+                ++pos_;
+            }
+        };
+        if (pos_ < text_.size() && text_[pos_] == '-') {
+            ++pos_;
+        }
+        if (pos_ < text_.size() && text_[pos_] == '0') {
+            ++pos_;
+        } else {
+            read_digits();
+        }
+        bool is_int = true;
+        if (pos_ < text_.size() && text_[pos_] == '.') {
+            ++pos_;
+            read_digits();
+            is_int = false;
+        }
+        if (pos_ < text_.size() && (text_[pos_] == 'e' || text_[pos_] == 'E')) {
+            ++pos_;
+            if (pos_ < text_.size() && (text_[pos_] == '+' || text_[pos_] == '-')) {
+                ++pos_;
+            }
+            read_digits();
+            is_int = false;
+        }
+
+        const char * first = text_.data() + begin;
+        const char * last = text_.data() + pos_;
+        if (is_int) {
+            int value = 0;
+            if (auto [ptr, ec] = std::from_chars(first, last, value); ec == std::errc{} && ptr == last) {
+                return value;
+            }
+            // при переполнении int разбираем число как double
+        }
+        double value = 0;
+        if (auto [ptr, ec] = std::from_chars(first, last, value); ec != std::errc{} || ptr != last) {
+            throw ParsingError("Failed to convert "s + std::string(first, last) + " to number"s);
+        }
+        return value;
+    }
+
+    // null, NULL, true или false
+    Node ScanSpecial() {
+        if (ScanWord("null"sv) || ScanWord("NULL"sv)) {
+            return Node{};
+        } else if (ScanWord("true"sv)) {
+            return Node(true);
+        } else if (ScanWord("false"sv)) {
+            return Node(false);
+        }
+        throw ParsingError("can't load special value");
+    }
+
+private:
+    static bool IsSpace(char ch) {
+        return ch == ' ' || ch == '\n' || ch == '\r' || ch == '\t' || ch == '\v' || ch == '\f';
+    }
+
+    static bool IsDigit(char ch) {
+        return ch >= '0' && ch <= '9';
+    }
+
+    bool ScanWord(std::string_view word) {
+        if (text_.substr(pos_, word.size()) != word) {
+            return false;
+        }
+        pos_ += word.size();
+        return true;
+    }
+
+    // продолжение строкового литерала с escape-последовательностями,
+    // уже разобранное начало лежит в storage
+    std::string_view ScanEscapedString(std::string & storage) {
+        for (; pos_ < text_.size(); ++pos_) {
+            const char ch = text_[pos_];
+            if (ch == '"') {
+                ++pos_;
+                return storage;
+            } else if (ch == '\\') {
+                if (++pos_ >= text_.size()) {
+                    throw ParsingError("String parsing error");
+                }
+                switch (const char escaped_char = text_[pos_]) {
+                    case 'n':  storage.push_back('\n'); break;
+                    case 't':  storage.push_back('\t'); break;
+                    case 'r':  storage.push_back('\r'); break;
+                    case '"':  storage.push_back('"');  break;
+                    case '\\': storage.push_back('\\'); break;
+                    default:
+                        throw ParsingError("Unrecognized escape sequence \\"s + escaped_char);
+                }
+            } else if (ch == '\n' || ch == '\r') {
+                throw ParsingError("Unexpected end of line"s);
+            } else {
+                storage.push_back(ch);
+            }
+        }
+        throw ParsingError("String parsing error");
+    }
+
+    std::string_view text_;
+    size_t pos_ = 0;
+};
+
+// построение документа по буферу
+class BufferParser {
+public:
+    explicit BufferParser(std::string_view text)
+        : lexer_(text)
+    {}
+
+    Node ParseNode() {
+        switch (lexer_.PeekToken()) {
+        case '[':
+            return ParseArray();
+        case '{':
+            return ParseDict();
+        case '"':
+            return Node(std::string(lexer_.ScanString(storage_)));
+        case 'N':
+        case 'n':
+        case 'f':
+        case 't':
+            return lexer_.ScanSpecial();
+        default:
+            return std::visit([](auto value) { return Node(value); }, lexer_.ScanNumber());
+        }
+    }
+
+private:
+    Node ParseArray() {
+        lexer_.Expect('[');
+        Array result;
+        if (!lexer_.Consume(']')) {
+            do {
+                result.push_back(ParseNode());
+            } while (lexer_.Consume(','));
+            lexer_.Expect(']');
+        }
+        return Node(std::move(result));
+    }
+
+    Node ParseDict() {
+        lexer_.Expect('{');
+        Dict result;
+        if (!lexer_.Consume('}')) {
+            do {
+                std::string key(lexer_.ScanString(storage_));
+                lexer_.Expect(':');
+                // как и при разборе из потока, повторный ключ не заменяет первый
+                result.emplace(std::move(key), ParseNode());
+            } while (lexer_.Consume(','));
+            lexer_.Expect('}');
+        }
+        return Node(std::move(result));
+    }
+
+    BufferLexer lexer_;
+    std::string storage_; // буфер для строк с escape-последовательностями
+};
+
+// разбор буфера с передачей событий обработчику
+class EventParser {
+public:
+    EventParser(std::string_view text, Handler & handler)
+        : lexer_(text)
+        , handler_(handler)
+    {}
+
+    void ParseValue() {
+        switch (lexer_.PeekToken()) {
+        case '[':
+            ParseArray();
+            break;
+        case '{':
+            ParseDict();
+            break;
+        case '"':
+            handler_.String(lexer_.ScanString(storage_));
+            break;
+        case 'N':
+        case 'n':
+        case 'f':
+        case 't':
+            if (const Node value = lexer_.ScanSpecial(); value.IsBool()) {
+                handler_.Bool(value.AsBool());
+            } else {
+                handler_.Null();
+            }
+            break;
+        default:
+            if (const Number value = lexer_.ScanNumber(); std::holds_alternative<int>(value)) {
+                handler_.Int(std::get<int>(value));
+            } else {
+                handler_.Double(std::get<double>(value));
+            }
+        }
+    }
+
+private:
+    void ParseArray() {
+        lexer_.Expect('[');
+        handler_.StartArray();
+        if (!lexer_.Consume(']')) {
+            do {
+                ParseValue();
+            } while (lexer_.Consume(','));
+            lexer_.Expect(']');
+        }
+        handler_.EndArray();
+    }
+
+    void ParseDict() {
+        lexer_.Expect('{');
+        handler_.StartDict();
+        if (!lexer_.Consume('}')) {
+            do {
+                handler_.Key(lexer_.ScanString(storage_));
+                lexer_.Expect(':');
+                ParseValue();
+            } while (lexer_.Consume(','));
+            lexer_.Expect('}');
+        }
+        handler_.EndDict();
+    }
+
+    BufferLexer lexer_;
+    Handler & handler_;
+    std::string storage_;
+};
+
 }  // namespace
 
 Node::Node(nullptr_t)
@@ -380,6 +678,88 @@ Document Load(istream& input) {
     return Document{LoadNode(input)};
 }
 
+Document LoadBuffer(std::string_view buffer) {
+    return Document{BufferParser(buffer).ParseNode()};
+}
+
+void Parse(std::string_view buffer, Handler & handler) {
+    EventParser(buffer, handler).ParseValue();
+}
+
+// /////////////////////////////////////////// //
+
+bool NodeBuilder::IsComplete() const {
+    return has_root_ && stack_.empty();
+}
+
+Node NodeBuilder::Extract() {
+    if (!IsComplete()) throw logic_error("node is not complete");
+    has_root_ = false;
+    ignored_.clear();
+    return std::move(root_);
+}
+
+Node* NodeBuilder::AddValue(Node node) {
+    if (stack_.empty()) {
+        if (has_root_) throw logic_error("node is already complete");
+        root_ = std::move(node);
+        has_root_ = true;
+        return &root_;
+    }
+    Node & top = *stack_.back();
+    if (top.IsArray()) {
+        return &top.AsArray().emplace_back(std::move(node));
+    }
+    auto [it, inserted] = top.AsMap().try_emplace(std::move(key_), std::move(node));
+    if (!inserted) {
+        // вложенные значения повторного ключа собираем отдельно и отбрасываем
+        return &ignored_.emplace_back(std::move(node));
+    }
+    return &it->second;
+}
+
+void NodeBuilder::StartDict() {
+    stack_.push_back(AddValue(Dict{}));
+}
+
+void NodeBuilder::Key(std::string_view key) {
+    key_.assign(key);
+}
+
+void NodeBuilder::EndDict() {
+    stack_.pop_back();
+}
+
+void NodeBuilder::StartArray() {
+    stack_.push_back(AddValue(Array{}));
+}
+
+void NodeBuilder::EndArray() {
+    stack_.pop_back();
+}
+
+void NodeBuilder::Null() {
+    AddValue(Node{});
+}
+
+void NodeBuilder::Bool(bool value) {
+    AddValue(Node(value));
+}
+
+void NodeBuilder::Int(int value) {
+    AddValue(Node(value));
+}
+
+void NodeBuilder::Double(double value) {
+    AddValue(Node(value));
+}
+
+void NodeBuilder::String(std::string_view value) {
+    AddValue(Node(std::string(value)));
+}
+
+// /////////////////////////////////////////// //
+
 void PrintNode(const Node& node, std::ostream& out);
 
 template <typename Value>
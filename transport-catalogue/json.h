@@ -1,8 +1,10 @@
 #pragma once
 
+#include <deque>
 #include <iostream>
 #include <map>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <variant>
 
@@ -77,6 +79,59 @@ private:
 
 Document Load(std::istream& input);
 
+// разбор документа, целиком лежащего в памяти. быстрее разбора из потока
+Document LoadBuffer(std::string_view buffer);
+
+// обработчик событий потокового разбора (SAX). строки и ключи передаются
+// представлениями, которые действительны только во время вызова
+class Handler {
+public:
+    virtual ~Handler() = default;
+
+    virtual void StartDict() = 0;
+    virtual void Key(std::string_view key) = 0;
+    virtual void EndDict() = 0;
+    virtual void StartArray() = 0;
+    virtual void EndArray() = 0;
+    virtual void Null() = 0;
+    virtual void Bool(bool value) = 0;
+    virtual void Int(int value) = 0;
+    virtual void Double(double value) = 0;
+    virtual void String(std::string_view value) = 0;
+};
+
+// разбор документа из буфера с передачей событий обработчику, без построения узлов
+void Parse(std::string_view buffer, Handler & handler);
+
+// собирает узел из событий одного значения: так обработчик может
+// материализовать только нужные ему части документа
+class NodeBuilder final : public Handler {
+public:
+    // значение собрано полностью
+    bool IsComplete() const;
+    Node Extract();
+
+    void StartDict() override;
+    void Key(std::string_view key) override;
+    void EndDict() override;
+    void StartArray() override;
+    void EndArray() override;
+    void Null() override;
+    void Bool(bool value) override;
+    void Int(int value) override;
+    void Double(double value) override;
+    void String(std::string_view value) override;
+
+private:
+    Node* AddValue(Node node);
+
+    Node root_;
+    bool has_root_ = false;
+    std::vector<Node*> stack_;   // открытые словари и массивы
+    std::string key_;
+    std::deque<Node> ignored_;   // значения повторных ключей, как и при разборе документа не заменяют первые
+};
+
 void Print(const Document& doc, std::ostream& output);
 
 }  // namespace json
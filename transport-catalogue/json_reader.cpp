@@ -1,23 +1,412 @@
 #include "json_reader.h"
 #include "transport_catalogue.h"
 #include "json.h"
+#include "metrics.h"
 
+#include <algorithm>
 #include <iostream>
 #include <cassert>
+#include <initializer_list>
+#include <map>
 #include <sstream>
+#include <string_view>
 
 using namespace json;
 using namespace domain;
 using namespace renderer;
+using namespace std::literals;
 
 namespace tcatalogue {
 
+// читаем поток целиком, чтобы разобрать документ из буфера
+static std::string ReadAll(std::istream & input) {
+    std::string result;
+    char chunk[1 << 16];
+    while (input.read(chunk, sizeof(chunk)) || input.gcount() > 0) {
+        result.append(chunk, static_cast<size_t>(input.gcount()));
+    }
+    return result;
+}
+
 JsonReader::JsonReader(std::istream & input) {
+    METRICS_SCOPE(metrics::Timer::JSON_PARSE);
+    try {
+        const std::string buffer = ReadAll(input);
+        doc_ = json::LoadBuffer(buffer);
+    } catch(...) {
+        // WARN() << "can't load json from stream";
+        doc_.reset();
+    }
+}
+
+// разбор входного документа по событиям. записи base_requests сразу
+// превращаются в остановки и маршруты, остальные ключи корня собираются в узлы
+class InputHandler final : public json::Handler {
+public:
+    InputHandler(STOPS & stops, BUSES & buses)
+        : stops_(stops)
+        , buses_(buses)
+    {}
+
+    json::Node ExtractRoot() {
+        return std::move(root_);
+    }
+
+    void StartDict() override {
+        if (Forward([](Handler & h) { h.StartDict(); }) || Skip(1)) {
+            return;
+        }
+        switch (state_) {
+        case State::DOCUMENT:
+            root_ = json::Dict{};
+            state_ = State::ROOT;
+            break;
+        case State::BASE_REQUESTS:
+            BeginEntry();
+            state_ = State::ENTRY;
+            break;
+        case State::ENTRY:
+            if (field_ == Field::ROAD_DISTANCES) {
+                state_ = State::ROAD_DISTANCES;
+            } else {
+                Invalidate();
+                skip_depth_ = 1;
+            }
+            break;
+        case State::ROOT:
+            Delegate([](Handler & h) { h.StartDict(); });
+            break;
+        default:
+            Invalidate();
+            skip_depth_ = 1;
+        }
+    }
+
+    void Key(std::string_view key) override {
+        if (Forward([key](Handler & h) { h.Key(key); }) || Skip(0)) {
+            return;
+        }
+        switch (state_) {
+        case State::ROOT:
+        case State::ROAD_DISTANCES:
+            key_.assign(key);
+            break;
+        case State::ENTRY:
+            field_ = FieldByName(key);
+            if (field_ != Field::NONE) {
+                // как и при разборе документа, повторный ключ не заменяет первый
+                if (seen_ & Bit(field_)) {
+                    field_ = Field::NONE;
+                } else {
+                    seen_ |= Bit(field_);
+                }
+            }
+            break;
+        default:
+            break;
+        }
+    }
+
+    void EndDict() override {
+        if (Forward([](Handler & h) { h.EndDict(); }) || Skip(-1)) {
+            return;
+        }
+        switch (state_) {
+        case State::ROOT:
+            state_ = State::DONE;
+            break;
+        case State::ENTRY:
+            FinishEntry();
+            state_ = State::BASE_REQUESTS;
+            break;
+        case State::ROAD_DISTANCES: {
+            // в документе road_distances - словарь: расстояния упорядочены
+            // по имени, а из повторных ключей остается первый
+            auto by_name = [](const auto & lhs, const auto & rhs) { return lhs.first < rhs.first; };
+            stop_.distances_.sort(by_name);
+            stop_.distances_.unique([](const auto & lhs, const auto & rhs) { return lhs.first == rhs.first; });
+            state_ = State::ENTRY;
+            break;
+        }
+        default:
+            break;
+        }
+    }
+
+    void StartArray() override {
+        if (Forward([](Handler & h) { h.StartArray(); }) || Skip(1)) {
+            return;
+        }
+        switch (state_) {
+        case State::ROOT:
+            if (key_ == "base_requests"sv && !root_.AsMap().count(key_)) {
+                // ключ помечаем в корне, чтобы повторный base_requests не разбирался
+                root_.AsMap().emplace(key_, json::Array{});
+                state_ = State::BASE_REQUESTS;
+            } else {
+                Delegate([](Handler & h) { h.StartArray(); });
+            }
+            break;
+        case State::ENTRY:
+            if (field_ == Field::STOPS) {
+                state_ = State::STOP_LIST;
+            } else {
+                Invalidate();
+                skip_depth_ = 1;
+            }
+            break;
+        case State::DOCUMENT:
+            Delegate([](Handler & h) { h.StartArray(); });
+            break;
+        default:
+            Invalidate();
+            skip_depth_ = 1;
+        }
+    }
+
+    void EndArray() override {
+        if (Forward([](Handler & h) { h.EndArray(); }) || Skip(-1)) {
+            return;
+        }
+        if (state_ == State::BASE_REQUESTS) {
+            state_ = State::ROOT;
+        } else if (state_ == State::STOP_LIST) {
+            state_ = State::ENTRY;
+        }
+    }
+
+    void Null() override {
+        Scalar([](Handler & h) { h.Null(); });
+    }
+
+    void Bool(bool value) override {
+        if (state_ == State::ENTRY && field_ == Field::IS_ROUNDTRIP && !Busy()) {
+            bus_.is_round_trip_ = value;
+            Validate();
+            return;
+        }
+        Scalar([value](Handler & h) { h.Bool(value); });
+    }
+
+    void Int(int value) override {
+        if (!Busy() && (state_ == State::ROAD_DISTANCES)) {
+            stop_.distances_.emplace_back(key_, value);
+            return;
+        }
+        if (!Coordinate(value)) {
+            Scalar([value](Handler & h) { h.Int(value); });
+        }
+    }
+
+    void Double(double value) override {
+        if (!Coordinate(value)) {
+            Scalar([value](Handler & h) { h.Double(value); });
+        }
+    }
+
+    void String(std::string_view value) override {
+        if (!Busy()) {
+            if (state_ == State::STOP_LIST) {
+                bus_.stops_.emplace_back(value);
+                return;
+            } else if (state_ == State::ENTRY && field_ == Field::TYPE) {
+                type_.assign(value);
+                Validate();
+                return;
+            } else if (state_ == State::ENTRY && field_ == Field::NAME) {
+                name_.assign(value);
+                Validate();
+                return;
+            }
+        }
+        Scalar([value](Handler & h) { h.String(value); });
+    }
+
+private:
+    enum class State {
+        DOCUMENT,       // до начала корня
+        ROOT,           // внутри корневого словаря
+        BASE_REQUESTS,  // внутри массива base_requests
+        ENTRY,          // внутри записи base_requests
+        ROAD_DISTANCES, // внутри road_distances записи
+        STOP_LIST,      // внутри stops записи
+        DONE,
+    };
+
+    enum class Field {
+        NONE, TYPE, NAME, LATITUDE, LONGITUDE, ROAD_DISTANCES, STOPS, IS_ROUNDTRIP,
+    };
+
+    // широта или долгота записи: в документе это int либо double
+    bool Coordinate(double value) {
+        if (state_ != State::ENTRY || Busy()) {
+            return false;
+        }
+        if (field_ == Field::LATITUDE) {
+            stop_.coordinates_.lat = value;
+        } else if (field_ == Field::LONGITUDE) {
+            stop_.coordinates_.lng = value;
+        } else {
+            return false;
+        }
+        Validate();
+        return true;
+    }
+
+    static unsigned Bit(Field field) {
+        return 1u << static_cast<unsigned>(field);
+    }
+
+    static Field FieldByName(std::string_view name) {
+        const static std::map<std::string_view, Field> fields = {
+            { "type"sv,           Field::TYPE },
+            { "name"sv,           Field::NAME },
+            { "latitude"sv,       Field::LATITUDE },
+            { "longitude"sv,      Field::LONGITUDE },
+            { "road_distances"sv, Field::ROAD_DISTANCES },
+            { "stops"sv,          Field::STOPS },
+            { "is_roundtrip"sv,   Field::IS_ROUNDTRIP },
+        };
+        auto it = fields.find(name);
+        return it == fields.end() ? Field::NONE : it->second;
+    }
+
+    // значение корня (или весь документ, если корень не словарь) собирается в узел
+    bool Busy() const {
+        return builder_.has_value() || skip_depth_ > 0;
+    }
+
+    template <typename Event>
+    bool Forward(Event event) {
+        if (!builder_.has_value()) {
+            return false;
+        }
+        event(*builder_);
+        if (builder_->IsComplete()) {
+            if (state_ == State::DOCUMENT) {
+                root_ = builder_->Extract();
+                state_ = State::DONE;
+            } else {
+                root_.AsMap().try_emplace(key_, builder_->Extract());
+            }
+            builder_.reset();
+        }
+        return true;
+    }
+
+    template <typename Event>
+    void Delegate(Event event) {
+        builder_.emplace();
+        Forward(event);
+    }
+
+    // пропуск значений, которые не нужны для записей base_requests
+    bool Skip(int depth_delta) {
+        if (skip_depth_ == 0) {
+            return false;
+        }
+        skip_depth_ += depth_delta;
+        return true;
+    }
+
+    template <typename Event>
+    void Scalar(Event event) {
+        if (Forward(event) || Skip(0)) {
+            return;
+        }
+        if (state_ == State::DOCUMENT || state_ == State::ROOT) {
+            Delegate(event);
+        } else if (state_ == State::ENTRY || state_ == State::ROAD_DISTANCES || state_ == State::STOP_LIST) {
+            // значение неподходящего типа
+            Invalidate();
+        }
+    }
+
+    void BeginEntry() {
+        seen_ = 0;
+        valid_ = 0;
+        invalid_ = 0;
+        field_ = Field::NONE;
+        type_.clear();
+        name_.clear();
+        stop_ = STOP{};
+        bus_ = BUS{};
+    }
+
+    void Validate() {
+        valid_ |= Bit(field_);
+    }
+
+    // значение поля записи имеет неподходящий тип
+    void Invalidate() {
+        const Field field = (state_ == State::ROAD_DISTANCES) ? Field::ROAD_DISTANCES
+                          : (state_ == State::STOP_LIST)      ? Field::STOPS
+                          : field_;
+        if (field != Field::NONE) {
+            invalid_ |= Bit(field);
+        }
+    }
+
+    bool Has(std::initializer_list<Field> fields) const {
+        for (Field field : fields) {
+            const bool is_container = (field == Field::ROAD_DISTANCES || field == Field::STOPS);
+            const bool present = is_container ? (seen_ & Bit(field)) : (valid_ & Bit(field));
+            if (!present || (invalid_ & Bit(field))) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // те же правила, что у WorkStop и WorkBus
+    void FinishEntry() {
+        if (!Has({Field::TYPE})) {
+            // нет типа записи
+        } else if (type_ == "Stop"sv) {
+            if (Has({Field::NAME, Field::LATITUDE, Field::LONGITUDE, Field::ROAD_DISTANCES})) {
+                stop_.stop_name_ = std::move(name_);
+                stops_.emplace_back(std::move(stop_));
+            }
+        } else if (type_ == "Bus"sv) {
+            if (Has({Field::NAME, Field::IS_ROUNDTRIP, Field::STOPS}) && !bus_.stops_.empty()) {
+                bus_.bus_id_ = std::move(name_);
+                buses_.emplace_back(std::move(bus_));
+            }
+        }
+    }
+
+    STOPS & stops_;
+    BUSES & buses_;
+
+    json::Node root_;
+    State state_ = State::DOCUMENT;
+    std::string key_;
+    std::optional<json::NodeBuilder> builder_;
+    int skip_depth_ = 0;
+
+    // разбираемая запись base_requests
+    Field field_ = Field::NONE;
+    unsigned seen_ = 0;
+    unsigned valid_ = 0;
+    unsigned invalid_ = 0;
+    std::string type_;
+    std::string name_;
+    STOP stop_;
+    BUS bus_;
+};
+
+JsonReader::JsonReader(std::istream & input, domain::STOPS & stops, domain::BUSES & buses) {
+    METRICS_SCOPE(metrics::Timer::JSON_PARSE);
     try {
-        doc_ = json::Load(input);
+        const std::string buffer = ReadAll(input);
+        InputHandler handler(stops, buses);
+        json::Parse(buffer, handler);
+        doc_ = json::Document(handler.ExtractRoot());
     } catch(...) {
         // WARN() << "can't load json from stream";
         doc_.reset();
+        stops.clear();
+        buses.clear();
     }
 }
 
@@ -102,8 +491,12 @@ void JsonReader::ParseStatRequests(STAT_REQUESTS & requests) {
         return;
     }
     const auto & m = doc_->GetRoot().AsMap();
-    const json::Array & arr_stat_requests = m.at("stat_requests").AsArray();
     requests.clear();
+    const auto it = m.find("stat_requests");
+    if (it == m.end()) {
+        return;
+    }
+    const json::Array & arr_stat_requests = it->second.AsArray();
     for (auto & node : arr_stat_requests) {
         if (!node.IsMap()) continue;
         const auto & m = node.AsMap();
@@ -197,6 +590,24 @@ domain::RoutingSettings FromJsonRouteSettings(const json::Dict & dict) {
 //    try {
     result.bus_velocity  = dict.at("bus_velocity").AsDouble();
     result.bus_wait_time = dict.at("bus_wait_time").AsDouble();
+    if (auto it = dict.find("router"); it != dict.end()) {
+        const static std::map<std::string, domain::RouterType> router_types = {
+            { "floyd_warshall", domain::RouterType::FLOYD_WARSHALL },
+            { "dijkstra",       domain::RouterType::DIJKSTRA },
+            { "contraction_hierarchies", domain::RouterType::CONTRACTION_HIERARCHIES },
+        };
+        result.router_type = router_types.at(it->second.AsString());
+    }
+    if (auto it = dict.find("graph_model"); it != dict.end()) {
+        const static std::map<std::string, domain::GraphModel> graph_models = {
+            { "all_spans", domain::GraphModel::ALL_SPANS },
+            { "on_board",  domain::GraphModel::ON_BOARD },
+        };
+        result.graph_model = graph_models.at(it->second.AsString());
+    }
+    if (auto it = dict.find("route_cache_kb"); it != dict.end()) {
+        result.route_cache_kb = static_cast<size_t>(std::max(0, it->second.AsInt()));
+    }
 //    } catch(...) {
 //        std::stringstream stream;
 //        json::Print(json::Document(dict), stream);
@@ -210,6 +621,16 @@ domain::SerializeSettings FromJsonSerializeSettings(const json::Dict & dict) {
     domain::SerializeSettings result;
 //    try {
     result.file = dict.at("file").AsString();
+    if (auto it = dict.find("store_map"); it != dict.end()) {
+        result.store_map = it->second.AsBool();
+    }
+    if (auto it = dict.find("format"); it != dict.end()) {
+        const static std::map<std::string, domain::BaseFormat> formats = {
+            { "protobuf", domain::BaseFormat::PROTOBUF },
+            { "flat",     domain::BaseFormat::FLAT },
+        };
+        result.format = formats.at(it->second.AsString());
+    }
 //    } catch(...) {
 //        std::stringstream stream;
 //        json::Print(json::Document(dict), stream);
@@ -14,6 +14,10 @@ class JsonReader {
 
 public:
     explicit JsonReader(std::istream & input);
+    // разбор без построения узлов для base_requests: остановки и маршруты
+    // сразу попадают в stops и buses, а ParseInput() для них уже не нужен.
+    // остальные разделы документа доступны как обычно
+    JsonReader(std::istream & input, domain::STOPS & stops, domain::BUSES & buses);
 
     bool IsOk() const;
     void ParseInput(domain::STOPS & stops, domain::BUSES &buses);
@@ -0,0 +1,117 @@
+#include "json_writer.h"
+
+#include <cassert>
+
+namespace json {
+
+using namespace std::literals;
+
+Writer::Writer(std::ostream & out)
+    : out_(out)
+{}
+
+Writer & Writer::StartDict() {
+    BeforeValue();
+    out_ << '{';
+    levels_.push_back({true, true});
+    return *this;
+}
+
+Writer & Writer::EndDict() {
+    assert(!levels_.empty() && levels_.back().is_dict);
+    levels_.pop_back();
+    out_ << '}';
+    return *this;
+}
+
+Writer & Writer::StartArray() {
+    BeforeValue();
+    out_ << '[';
+    levels_.push_back({false, true});
+    return *this;
+}
+
+Writer & Writer::EndArray() {
+    assert(!levels_.empty() && !levels_.back().is_dict);
+    levels_.pop_back();
+    out_ << ']';
+    return *this;
+}
+
+Writer & Writer::Key(std::string_view key) {
+    assert(!levels_.empty() && levels_.back().is_dict);
+    if (!levels_.back().empty) {
+        out_ << ", "sv;
+    }
+    levels_.back().empty = false;
+    WriteString(key);
+    out_ << ": "sv;
+    return *this;
+}
+
+Writer & Writer::Value(int value) {
+    BeforeValue();
+    out_ << value;
+    return *this;
+}
+
+Writer & Writer::Value(double value) {
+    BeforeValue();
+    out_ << value;
+    return *this;
+}
+
+Writer & Writer::Value(bool value) {
+    BeforeValue();
+    out_ << (value ? "true"sv : "false"sv);
+    return *this;
+}
+
+Writer & Writer::Value(std::string_view value) {
+    BeforeValue();
+    WriteString(value);
+    return *this;
+}
+
+Writer & Writer::Value(const char * value) {
+    return Value(std::string_view(value));
+}
+
+Writer & Writer::Value(std::nullptr_t) {
+    BeforeValue();
+    out_ << "null"sv;
+    return *this;
+}
+
+void Writer::BeforeValue() {
+    // значение словаря идет сразу после ключа, а разделитель ставит Key()
+    if (levels_.empty() || levels_.back().is_dict) {
+        return;
+    }
+    if (!levels_.back().empty) {
+        out_ << ',';
+    }
+    levels_.back().empty = false;
+}
+
+// экранирование как в json::Print: \, ", \r и \n, остальные символы как есть.
+// участки без спецсимволов выводятся целиком.
+void Writer::WriteString(std::string_view value) {
+    out_ << '"';
+    size_t begin = 0;
+    for (size_t i = 0; i < value.size(); ++i) {
+        std::string_view escaped;
+        switch (value[i]) {
+        case '\\': escaped = "\\\\"sv; break;
+        case '"':  escaped = "\\\""sv; break;
+        case '\r': escaped = "\\r"sv; break;
+        case '\n': escaped = "\\n"sv; break;
+        default: continue;
+        }
+        out_ << value.substr(begin, i - begin) << escaped;
+        begin = i + 1;
+    }
+    out_ << value.substr(begin) << '"';
+}
+
+}  // namespace json
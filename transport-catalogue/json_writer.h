@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <ostream>
+#include <string_view>
+#include <vector>
+
+namespace json {
+
+// Потоковая запись JSON без построения дерева json::Node. Формат вывода
+// совпадает с json::Print: разделители ", " и ": " в словарях, "," в
+// массивах, числа выводятся с настройками потока. json::Dict упорядочен по
+// ключам, поэтому для совпадения с json::Print ключи словаря нужно
+// передавать в порядке возрастания.
+class Writer {
+public:
+    explicit Writer(std::ostream & out);
+
+    Writer & StartDict();
+    Writer & EndDict();
+    Writer & StartArray();
+    Writer & EndArray();
+    Writer & Key(std::string_view key);
+    Writer & Value(int value);
+    Writer & Value(double value);
+    Writer & Value(bool value);
+    Writer & Value(std::string_view value);
+    Writer & Value(const char * value);
+    Writer & Value(std::nullptr_t);
+
+private:
+    // вызывается перед каждым значением, ставит разделитель элементов массива
+    void BeforeValue();
+    void WriteString(std::string_view value);
+
+    struct Level {
+        bool is_dict = false;
+        bool empty = true;
+    };
+    std::ostream & out_;
+    std::vector<Level> levels_;
+};
+
+}  // namespace json
@@ -6,139 +6,452 @@
 #include "json_reader.h"
 #include "request_handler.h"
 #include "map_renderer.h"
-#include "json_builder.h"
+#include "json_writer.h"
 #include "serialization.h"
+#include "transport_router.h"
+#include "metrics.h"
+#include <algorithm>
 #include <cassert>
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#define TC_HAS_UNIX_SOCKET 1
+#endif
 
 #include "domain.h"
 
-using namespace json;
 using namespace domain;
 using namespace tcatalogue;
 using namespace std::literals;
 
-void FillStatResponse(const RESP_ERROR & resp, json::Builder & builder) {
-    builder.StartDict()
-        .Key("request_id").Value(resp.request_id)
+// отклики пишутся сразу в поток вывода. ключи словарей идут в порядке
+// возрастания, как их выводит json::Print для json::Dict.
+void WriteStatResponse(const RESP_ERROR & resp, json::Writer & writer) {
+    writer.StartDict()
         .Key("error_message").Value(resp.error_message)
+        .Key("request_id").Value(resp.request_id)
         .EndDict();
 }
 
-void FillStatResponse(const STAT_RESP_BUS & resp, json::Builder & builder) {
-    builder.StartDict()
-        .Key("request_id").Value(resp.request_id)
+void WriteStatResponse(const STAT_RESP_BUS & resp, json::Writer & writer) {
+    writer.StartDict()
         .Key("curvature").Value(resp.curvature)
+        .Key("request_id").Value(resp.request_id)
         .Key("route_length").Value(resp.route_length)
         .Key("stop_count").Value(resp.stop_count)
         .Key("unique_stop_count").Value(resp.unique_stop_count)
         .EndDict();
 }
 
-void FillStatResponse(const STAT_RESP_STOP & resp, json::Builder & builder) {
-    builder.StartDict()
-        .Key("request_id").Value(resp.request_id)
+void WriteStatResponse(const STAT_RESP_STOP & resp, json::Writer & writer) {
+    writer.StartDict()
         .Key("buses").StartArray();
     for (const auto & bus_name : resp.buses) {
-        builder.Value(std::string(bus_name));
+        writer.Value(bus_name);
     }
-    builder.EndArray().EndDict();
+    writer.EndArray()
+        .Key("request_id").Value(resp.request_id)
+        .EndDict();
 }
 
-void FillStatResponse(const STAT_RESP_MAP & resp, json::Builder & builder) {
-    builder.StartDict()
+void WriteStatResponse(const STAT_RESP_MAP & resp, json::Writer & writer) {
+    writer.StartDict()
+        .Key("map").Value(*resp.map)
         .Key("request_id").Value(resp.request_id)
-        .Key("map").Value(std::move(resp.map))
         .EndDict();
 }
 
-void FillStatResponse(const STAT_RESP_ROUTE & resp, json::Builder & builder) {
-    auto array_context = builder.StartDict()
-        .Key("request_id").Value(resp.request_id)
-        .Key("total_time").Value(resp.total_time)
+void WriteStatResponse(const STAT_RESP_ROUTE & resp, json::Writer & writer) {
+    writer.StartDict()
         .Key("items").StartArray();
-    for (const auto & item : resp.items) {
-        auto item_dict = array_context.StartDict();
+    for (const auto & item : resp.route->items) {
+        writer.StartDict();
         if (item.IsWait()) {
             const auto & wait_item = item.Wait();
-            item_dict.Key("type").Value("Wait");
-            item_dict.Key("stop_name").Value(wait_item.stop_name);
-            item_dict.Key("time").Value(wait_item.time);
+            writer.Key("stop_name").Value(wait_item.stop_name);
+            writer.Key("time").Value(wait_item.time);
+            writer.Key("type").Value("Wait");
         } else if (item.IsBus()) {
             const auto & bus_item = item.Bus();
-            item_dict.Key("type").Value("Bus");
-            item_dict.Key("bus").Value(bus_item.bus);
-            item_dict.Key("span_count").Value(bus_item.span_count);
-            item_dict.Key("time").Value(bus_item.time);
+            writer.Key("bus").Value(bus_item.bus);
+            writer.Key("span_count").Value(bus_item.span_count);
+            writer.Key("time").Value(bus_item.time);
+            writer.Key("type").Value("Bus");
         } else {
             // FIXME: invalid item type!!!
         }
-        item_dict.EndDict();
+        writer.EndDict();
     }
-    builder.EndArray().EndDict();
+    writer.EndArray()
+        .Key("request_id").Value(resp.request_id)
+        .Key("total_time").Value(resp.route->total_time)
+        .EndDict();
 }
 
 void PrintUsage(std::ostream& stream = std::cerr) {
-    stream << "Usage: transport_catalogue [make_base|process_requests]\n"sv;
+    stream << "Usage: transport_catalogue [make_base|process_requests|serve] [--threads N] [--socket PATH]"sv
+           << " [--metrics FILE|-]\n"sv;
 }
 
-int ProcessRequests() {
-    JsonReader reader(std::cin);
-    if (!reader.IsOk()) {
-        return EXIT_FAILURE;
+// документ с метриками в файл или, если path == "-", в stderr
+void WriteMetrics(const std::string & path) {
+    if (path.empty()) {
+        return;
     }
+    if (path == "-"sv) {
+        metrics::WriteJson(std::cerr);
+        return;
+    }
+    std::ofstream output(path);
+    metrics::WriteJson(output);
+}
+
+// число потоков по умолчанию - по числу ядер
+size_t DefaultThreadCount() {
+    return std::max(1u, std::thread::hardware_concurrency());
+}
 
+// загруженная база и обработчик запросов к ней. в режиме serve живет
+// между пакетами запросов вместе с графом маршрутов и картой
+struct LoadedBase {
     Serialization::Context context;
+    TransportCatalogue db;
+    std::optional<renderer::MapRenderer> drawer;
+    std::optional<RequestHandler> handler;
+};
+
+bool LoadBase(JsonReader & reader, LoadedBase & base) {
+    Serialization::Context & context = base.context;
     context.serialize_settings = reader.ParseSerializeSettings();
     if (!context.serialize_settings.has_value()) {
         // WARN() << "can't parse serialize_settings!" << std::endl;
-        return EXIT_FAILURE;
+        return false;
     }
 
-    TransportCatalogue db; {
-        if (!Serialization::Read(context)) {
-            // WARN() << "can't parse serialized database!" << std::endl;
-            return EXIT_FAILURE;
-        }
-        FillDatabase(db, context.stops, context.busses);
+    if (!Serialization::Load(context, base.db)) {
+        // WARN() << "can't parse serialized database!" << std::endl;
+        return false;
     }
 
-    STAT_RESPONSES responses; {
-        STAT_REQUESTS stat_requests;
-        reader.ParseStatRequests(stat_requests);
-        if (stat_requests.empty()) {
-            //LOG() << "stat_requests is empty." << std::endl;
-        } else {
-            renderer::MapRenderer drawer(context.render_settings.value());
-            RequestHandler handler(db, drawer, context.routing_settings.value());
-            FillStatResponses(handler, stat_requests, responses);
+    base.drawer.emplace(context.render_settings.value());
+    base.handler.emplace(base.db, *base.drawer, context.routing_settings.value());
+    if (context.route_graph.has_value()) {
+        if (!base.handler->LoadRouteGraph(std::move(context.route_graph.value()))) {
+            return false;
         }
+        context.route_graph.reset();
     }
+    if (context.rendered_map.has_value()) {
+        base.handler->LoadRenderedMap(std::move(context.rendered_map.value()));
+        context.rendered_map.reset();
+    }
+    return true;
+}
 
-    if (responses.empty()) {
-        //LOG() << "responses is empty." << std::endl;
-    } else {
-        json::Builder builder;
-        builder.StartArray();
+// отклики выводятся блоками по мере готовности, без построения
+// общего документа json. false, если откликов нет и ничего не выведено
+bool WriteStatResponses(const RequestHandler & handler, const STAT_REQUESTS & stat_requests,
+                        size_t thread_count, std::ostream & output) {
+    static constexpr size_t RESPONSES_CHUNK_SIZE = 4096;
+    json::Writer writer(output);
+    bool started = false;
+    ProcessStatRequests(handler, stat_requests, thread_count, RESPONSES_CHUNK_SIZE,
+                        [&writer, &started](const STAT_RESPONSES & responses) {
         for (const STAT_RESPONSE & resp : responses) {
-            std::visit([&builder](const auto & stat_response) {
-                FillStatResponse(stat_response, builder);
+            if (!started) {
+                writer.StartArray();
+                started = true;
+            }
+            std::visit([&writer](const auto & stat_response) {
+                WriteStatResponse(stat_response, writer);
             }, resp);
         }
-        builder.EndArray();
+    });
+    if (started) {
+        writer.EndArray();
+    }
+    return started;
+}
+
+int ProcessRequests(size_t thread_count) {
+    JsonReader reader(std::cin);
+    if (!reader.IsOk()) {
+        return EXIT_FAILURE;
+    }
+
+    LoadedBase base;
+    if (!LoadBase(reader, base)) {
+        return EXIT_FAILURE;
+    }
 
-        json::Print(json::Document(builder.Build()), std::cout);
+    STAT_REQUESTS stat_requests;
+    reader.ParseStatRequests(stat_requests);
+    if (stat_requests.empty()) {
+        //LOG() << "stat_requests is empty." << std::endl;
+        return EXIT_SUCCESS;
     }
 
+    if (!WriteStatResponses(*base.handler, stat_requests, thread_count, std::cout)) {
+        //LOG() << "responses is empty." << std::endl;
+    }
     return EXIT_SUCCESS;
 }
 
-int MakeBase() {
-    JsonReader reader(std::cin);
-    if (!reader.IsOk()) {
+// Режим serve. База загружается один раз, затем из потока читаются пакеты
+// запросов - документы с ключом stat_requests, как у process_requests.
+// Пакет занимает одну строку либо предваряется строкой с его длиной в байтах:
+//     {"stat_requests": [...]}\n
+//     1234\n{"stat_requests": [...]}
+// Отклик на пакет - массив откликов в той же разметке: одна строка или
+// строка с длиной и сам массив. Первый документ stdin задает
+// serialization_settings базы, его stat_requests тоже выполняются.
+// На длину больше MAX_BATCH_SIZE и на пакет короче заявленной длины
+// отвечаем error_message и закрываем поток.
+class BatchStream {
+public:
+    static constexpr size_t MAX_BATCH_SIZE = 64u << 20;
+
+    BatchStream(std::istream & input, std::ostream & output)
+        : input_(input)
+        , output_(output)
+    {}
+
+    // false, если поток кончился или длина пакета недопустима
+    bool Read(std::string & batch) {
+        std::string line;
+        while (std::getline(input_, line)) {
+            const std::string_view text = trim(std::string_view(line));
+            if (text.empty()) {
+                continue;
+            }
+            sized_ = std::all_of(text.begin(), text.end(), [](char c) { return c >= '0' && c <= '9'; });
+            if (!sized_) {
+                batch = std::move(line);
+                return true;
+            }
+            errno = 0;
+            const unsigned long long size = std::strtoull(std::string(text).c_str(), nullptr, 10);
+            if (errno == ERANGE || size > MAX_BATCH_SIZE) {
+                WriteError("batch is too large"sv);
+                return false;
+            }
+            batch.resize(static_cast<size_t>(size));
+            if (!input_.read(batch.data(), static_cast<std::streamsize>(size))) {
+                WriteError("batch is truncated"sv);
+                return false;
+            }
+            return true;
+        }
+        return false;
+    }
+
+    // отклик в разметке последнего прочитанного пакета
+    void Write(std::string_view response) {
+        if (sized_) {
+            output_ << response.size() << '\n' << response;
+        } else {
+            output_ << response << '\n';
+        }
+        output_.flush();
+    }
+
+private:
+    std::istream & input_;
+    std::ostream & output_;
+    bool sized_ = false;
+
+    void WriteError(std::string_view message) {
+        std::ostringstream error;
+        json::Writer(error).StartDict().Key("error_message").Value(message).EndDict();
+        Write(error.str());
+    }
+};
+
+// ответ на один пакет. разобрать пакет не удалось - отклик с error_message,
+// сервер при этом продолжает работу
+std::string AnswerBatch(const RequestHandler & handler, const std::string & batch, size_t thread_count) {
+    std::istringstream input(batch);
+    JsonReader reader(input);
+    std::ostringstream output;
+    STAT_REQUESTS stat_requests;
+    bool parsed = reader.IsOk();
+    if (parsed) {
+        try {
+            reader.ParseStatRequests(stat_requests);
+        } catch (const std::exception &) {
+            parsed = false;
+        }
+    }
+    if (!parsed) {
+        json::Writer(output).StartDict().Key("error_message").Value("invalid batch").EndDict();
+        return output.str();
+    }
+    if (!WriteStatResponses(handler, stat_requests, thread_count, output)) {
+        json::Writer(output).StartArray().EndArray();
+    }
+    return output.str();
+}
+
+void ServeStream(const RequestHandler & handler, BatchStream & stream, size_t thread_count) {
+    std::string batch;
+    while (stream.Read(batch)) {
+        stream.Write(AnswerBatch(handler, batch, thread_count));
+    }
+}
+
+#ifdef TC_HAS_UNIX_SOCKET
+// буфер потока поверх дескриптора сокета
+class SocketBuf : public std::streambuf {
+public:
+    explicit SocketBuf(int fd)
+        : fd_(fd) {
+        setg(input_, input_, input_);
+        setp(output_, output_ + sizeof(output_));
+    }
+
+    ~SocketBuf() override {
+        sync();
+    }
+
+protected:
+    int_type underflow() override {
+        const ssize_t size = ::read(fd_, input_, sizeof(input_));
+        if (size <= 0) {
+            return traits_type::eof();
+        }
+        setg(input_, input_, input_ + size);
+        return traits_type::to_int_type(input_[0]);
+    }
+
+    int_type overflow(int_type c) override {
+        if (sync() != 0) {
+            return traits_type::eof();
+        }
+        if (!traits_type::eq_int_type(c, traits_type::eof())) {
+            *pptr() = traits_type::to_char_type(c);
+            pbump(1);
+        }
+        return traits_type::not_eof(c);
+    }
+
+    int sync() override {
+        for (const char * data = pbase(); data < pptr();) {
+            const ssize_t size = ::write(fd_, data, static_cast<size_t>(pptr() - data));
+            if (size <= 0) {
+                return -1;
+            }
+            data += size;
+        }
+        setp(output_, output_ + sizeof(output_));
+        return 0;
+    }
+
+private:
+    int fd_;
+    char input_[1 << 16];
+    char output_[1 << 16];
+};
+
+// клиенты обслуживаются по очереди: пакет и так выполняется в thread_count потоков
+// метрики с начала работы выводятся после каждого клиента
+int ServeSocket(const RequestHandler & handler, const std::string & path, size_t thread_count,
+                const std::string & metrics_path) {
+    sockaddr_un address{};
+    if (path.size() >= sizeof(address.sun_path)) {
+        std::cerr << "socket path is too long: "sv << path << '\n';
+        return EXIT_FAILURE;
+    }
+    address.sun_family = AF_UNIX;
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+    const int server = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (server < 0) {
+        std::perror("socket");
+        return EXIT_FAILURE;
+    }
+    ::unlink(path.c_str());
+    if (::bind(server, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0
+            || ::listen(server, SOMAXCONN) != 0) {
+        std::perror(path.c_str());
+        ::close(server);
         return EXIT_FAILURE;
     }
+    while (true) {
+        const int client = ::accept(server, nullptr, nullptr);
+        if (client < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            std::perror("accept");
+            break;
+        }
+        {
+            SocketBuf buffer(client);
+            std::istream input(&buffer);
+            std::ostream output(&buffer);
+            BatchStream stream(input, output);
+            ServeStream(handler, stream, thread_count);
+        }
+        ::close(client);
+        WriteMetrics(metrics_path);
+    }
+    ::close(server);
+    ::unlink(path.c_str());
+    return EXIT_FAILURE;
+}
+#endif
+
+int Serve(size_t thread_count, const std::string & socket_path, const std::string & metrics_path) {
+#ifdef TC_HAS_UNIX_SOCKET
+    // клиент, закрывший соединение до отклика, не должен завершать процесс
+    std::signal(SIGPIPE, SIG_IGN);
+#endif
+    BatchStream stdio(std::cin, std::cout);
+    std::string batch;
+    if (!stdio.Read(batch)) {
+        return EXIT_FAILURE;
+    }
+    std::istringstream settings(batch);
+    JsonReader reader(settings);
+    LoadedBase base;
+    if (!reader.IsOk() || !LoadBase(reader, base)) {
+        return EXIT_FAILURE;
+    }
+    const RequestHandler & handler = *base.handler;
+    stdio.Write(AnswerBatch(handler, batch, thread_count));
 
+    if (socket_path.empty()) {
+        ServeStream(handler, stdio, thread_count);
+        return EXIT_SUCCESS;
+    }
+#ifdef TC_HAS_UNIX_SOCKET
+    return ServeSocket(handler, socket_path, thread_count, metrics_path);
+#else
+    std::cerr << "unix sockets are not supported\n"sv;
+    return EXIT_FAILURE;
+#endif
+}
+
+int MakeBase(size_t thread_count) {
+    // остановки и маршруты разбираем сразу, не строя для них узлы документа
     Serialization::Context context;
+    JsonReader reader(std::cin, context.stops, context.busses);
+    if (!reader.IsOk()) {
+        return EXIT_FAILURE;
+    }
+
     context.serialize_settings = reader.ParseSerializeSettings();
     if (!context.serialize_settings.has_value()) {
         // WARN() << "can't parse serialize_settings!" << std::endl;
@@ -157,24 +470,72 @@ int MakeBase() {
         return EXIT_FAILURE;
     }
 
-    reader.ParseInput(context.stops, context.busses);
+    // граф маршрутов строим сразу, чтобы при обработке запросов
+    // не тратить время на его подготовку
+    TransportCatalogue db;
+    FillDatabase(db, context.stops, context.busses);
+    RouteGraph route_graph(db, context.routing_settings.value());
+    route_graph.Prepare(thread_count);
+    context.route_graph = route_graph.Save();
+    // показатели маршрутов посчитаны при заполнении каталога
+    context.bus_stats = db.GetAllBusStats();
+
+    // карту рисуем заранее, если это задано в настройках базы
+    if (context.serialize_settings->store_map) {
+        renderer::MapRenderer drawer(context.render_settings.value());
+        RequestHandler handler(db, drawer, context.routing_settings.value());
+        context.rendered_map = *handler.DrawMap();
+    }
+
     Serialization::Write(context);
     return EXIT_SUCCESS;
 }
 
 int main(int argc, char* argv[]) {
-    if (argc != 2) {
+    if (argc < 2) {
         PrintUsage();
         return EXIT_FAILURE;
     }
     const std::string_view mode(argv[1]);
+    size_t thread_count = DefaultThreadCount();
+    std::string socket_path;
+    std::string metrics_path;
+    for (int i = 2; i < argc; i += 2) {
+        const std::string_view option(argv[i]);
+        if (i + 1 == argc) {
+            PrintUsage();
+            return EXIT_FAILURE;
+        }
+        if (option == "--threads"sv && std::atoi(argv[i + 1]) > 0) {
+            thread_count = static_cast<size_t>(std::atoi(argv[i + 1]));
+        } else if (option == "--socket"sv && mode == "serve"sv) {
+            socket_path = argv[i + 1];
+        } else if (option == "--metrics"sv) {
+            metrics_path = argv[i + 1];
+        } else {
+            PrintUsage();
+            return EXIT_FAILURE;
+        }
+    }
+    if (!metrics_path.empty()) {
+#ifdef TC_METRICS
+        metrics::Enable();
+#else
+        std::cerr << "metrics are not compiled in, rebuild with -DTC_METRICS=ON\n"sv;
+        metrics_path.clear();
+#endif
+    }
+    int result = EXIT_SUCCESS;
     if (mode == "make_base"sv) {
-        return MakeBase();
+        result = MakeBase(thread_count);
     } else if (mode == "process_requests"sv) {
-        return ProcessRequests();
+        result = ProcessRequests(thread_count);
+    } else if (mode == "serve"sv) {
+        result = Serve(thread_count, socket_path, metrics_path);
     } else {
         PrintUsage();
         return EXIT_FAILURE;
     }
+    WriteMetrics(metrics_path);
+    return result;
 }
-
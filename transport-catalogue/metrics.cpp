@@ -0,0 +1,158 @@
+#include "metrics.h"
+
+#include "json_writer.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <iterator>
+#include <ostream>
+#include <sstream>
+#include <string_view>
+
+using namespace std::literals;
+
+namespace metrics {
+
+namespace {
+
+// интервал i гистограммы - времена [2^(i-1), 2^i) наносекунд
+constexpr size_t BUCKET_COUNT = 64;
+
+struct TimerData {
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint64_t> total_ns{0};
+    std::atomic<uint64_t> max_ns{0};
+    std::atomic<uint64_t> buckets[BUCKET_COUNT] = {};
+};
+
+TimerData timers[static_cast<size_t>(Timer::COUNT)];
+std::atomic<uint64_t> counters[static_cast<size_t>(Counter::COUNT)] = {};
+
+constexpr std::string_view TIMER_NAMES[] = {
+    "json_parse"sv,
+    "base_write"sv,
+    "base_load"sv,
+    "fill_database"sv,
+    "graph_build"sv,
+    "router_precompute"sv,
+    "router_load"sv,
+    "map_render"sv,
+    "request_bus"sv,
+    "request_stop"sv,
+    "request_route"sv,
+    "request_route_group"sv,
+    "request_map"sv,
+};
+static_assert(std::size(TIMER_NAMES) == static_cast<size_t>(Timer::COUNT));
+
+constexpr std::string_view COUNTER_NAMES[] = {
+    "graph_edges"sv,
+    "ch_shortcuts"sv,
+    "dijkstra_relaxations"sv,
+    "ch_relaxations"sv,
+    "scratch_reused"sv,
+    "scratch_allocated"sv,
+    "map_cache_hits"sv,
+    "route_cache_hits"sv,
+    "route_cache_misses"sv,
+    "routes_grouped"sv,
+};
+static_assert(std::size(COUNTER_NAMES) == static_cast<size_t>(Counter::COUNT));
+
+size_t BucketOf(uint64_t ns) {
+    size_t bucket = 0;
+    while (ns != 0 && bucket + 1 < BUCKET_COUNT) {
+        ns >>= 1;
+        ++bucket;
+    }
+    return bucket;
+}
+
+// верхняя граница интервала, в который попала доля share замеров,
+// но не больше наибольшего замера
+double PercentileMs(const TimerData & data, uint64_t count, double share) {
+    const uint64_t max_ns = data.max_ns.load(std::memory_order_relaxed);
+    const uint64_t rank = static_cast<uint64_t>(share * static_cast<double>(count - 1)) + 1;
+    uint64_t seen = 0;
+    for (size_t bucket = 0; bucket < BUCKET_COUNT; ++bucket) {
+        seen += data.buckets[bucket].load(std::memory_order_relaxed);
+        if (seen >= rank) {
+            return static_cast<double>(std::min(uint64_t{1} << bucket, max_ns)) / 1e6;
+        }
+    }
+    return static_cast<double>(max_ns) / 1e6;
+}
+
+} // namespace
+
+namespace detail {
+
+std::atomic<bool> enabled{false};
+
+void Record(Timer timer, uint64_t ns) {
+    TimerData & data = timers[static_cast<size_t>(timer)];
+    data.count.fetch_add(1, std::memory_order_relaxed);
+    data.total_ns.fetch_add(ns, std::memory_order_relaxed);
+    data.buckets[BucketOf(ns)].fetch_add(1, std::memory_order_relaxed);
+    uint64_t max_ns = data.max_ns.load(std::memory_order_relaxed);
+    while (ns > max_ns && !data.max_ns.compare_exchange_weak(max_ns, ns, std::memory_order_relaxed)) {
+    }
+}
+
+void Add(Counter counter, uint64_t value) {
+    counters[static_cast<size_t>(counter)].fetch_add(value, std::memory_order_relaxed);
+}
+
+} // namespace detail
+
+void Enable() {
+    detail::enabled.store(true, std::memory_order_relaxed);
+}
+
+void Reset() {
+    for (TimerData & data : timers) {
+        data.count = 0;
+        data.total_ns = 0;
+        data.max_ns = 0;
+        for (auto & bucket : data.buckets) {
+            bucket = 0;
+        }
+    }
+    for (auto & counter : counters) {
+        counter = 0;
+    }
+}
+
+void WriteJson(std::ostream & out) {
+    // счетчики бывают больше int, поэтому пишутся как double с точностью,
+    // при которой целые до 10^15 выводятся без экспоненты
+    std::ostringstream text;
+    text << std::setprecision(15);
+    json::Writer writer(text);
+    writer.StartDict()
+        .Key("counters").StartDict();
+    for (size_t i = 0; i < std::size(COUNTER_NAMES); ++i) {
+        writer.Key(COUNTER_NAMES[i]).Value(static_cast<double>(counters[i].load(std::memory_order_relaxed)));
+    }
+    writer.EndDict()
+        .Key("timers").StartDict();
+    for (size_t i = 0; i < std::size(TIMER_NAMES); ++i) {
+        const TimerData & data = timers[i];
+        const uint64_t count = data.count.load(std::memory_order_relaxed);
+        writer.Key(TIMER_NAMES[i]).StartDict()
+            .Key("count").Value(static_cast<double>(count));
+        if (count != 0) {
+            writer.Key("max_ms").Value(static_cast<double>(data.max_ns.load(std::memory_order_relaxed)) / 1e6)
+                .Key("p50_ms").Value(PercentileMs(data, count, 0.50))
+                .Key("p90_ms").Value(PercentileMs(data, count, 0.90))
+                .Key("p99_ms").Value(PercentileMs(data, count, 0.99))
+                .Key("total_ms").Value(static_cast<double>(data.total_ns.load(std::memory_order_relaxed)) / 1e6);
+        }
+        writer.EndDict();
+    }
+    writer.EndDict()
+        .EndDict();
+    out << text.str() << '\n';
+}
+
+} // namespace metrics
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iosfwd>
+
+// Счетчики и таймеры этапов работы справочника. Сбор включается во время
+// работы вызовом Enable() (ключ --metrics), до этого каждое место замера
+// стоит одной проверки флага. Сборка без TC_METRICS убирает места замеров
+// целиком: макросы METRICS_* раскрываются в пустые выражения.
+// Все функции можно вызывать из нескольких потоков.
+namespace metrics {
+
+// таймеры накапливают число замеров, суммарное и наибольшее время и
+// гистограмму по степеням двойки для процентилей
+enum class Timer {
+    JSON_PARSE,        // разбор входного документа
+    BASE_WRITE,        // запись базы
+    BASE_LOAD,         // чтение базы в каталог
+    FILL_DATABASE,     // заполнение каталога из разобранного документа
+    GRAPH_BUILD,       // построение графа маршрутов
+    ROUTER_PRECOMPUTE, // предвычисления маршрутизатора при подготовке графа
+    ROUTER_LOAD,       // граф и маршрутизатор из сохраненных в базе данных
+    MAP_RENDER,
+    REQUEST_BUS,
+    REQUEST_STOP,
+    REQUEST_ROUTE,
+    REQUEST_ROUTE_GROUP, // группа запросов Route с общей начальной остановкой
+    REQUEST_MAP,
+    COUNT,
+};
+
+enum class Counter {
+    GRAPH_EDGES,          // ребер создано при построении графа
+    CH_SHORTCUTS,         // вспомогательных ребер иерархии сжатия
+    DIJKSTRA_RELAXATIONS, // улучшенных расстояний в поиске Дейкстры
+    CH_RELAXATIONS,       // улучшенных расстояний в поиске по иерархии сжатия
+    SCRATCH_REUSED,       // рабочие массивы поиска взяты из пула
+    SCRATCH_ALLOCATED,    // рабочие массивы поиска созданы заново
+    MAP_CACHE_HITS,       // запрос Map получил уже готовую карту
+    ROUTE_CACHE_HITS,     // ответ Route найден в кеше
+    ROUTE_CACHE_MISSES,
+    ROUTES_GROUPED,       // запросов Route отвечено в группах по начальной остановке
+    COUNT,
+};
+
+namespace detail {
+extern std::atomic<bool> enabled;
+void Record(Timer timer, uint64_t ns);
+void Add(Counter counter, uint64_t value);
+} // namespace detail
+
+inline bool IsEnabled() {
+    return detail::enabled.load(std::memory_order_relaxed);
+}
+
+void Enable();
+
+// сбрасывает накопленные значения
+void Reset();
+
+inline void Add(Counter counter, uint64_t value = 1) {
+    if (IsEnabled()) {
+        detail::Add(counter, value);
+    }
+}
+
+// замер времени до конца области видимости
+class ScopedTimer {
+public:
+    explicit ScopedTimer(Timer timer)
+        : timer_(timer)
+        , active_(IsEnabled()) {
+        if (active_) {
+            start_ = std::chrono::steady_clock::now();
+        }
+    }
+
+    ScopedTimer(const ScopedTimer &) = delete;
+    ScopedTimer& operator=(const ScopedTimer &) = delete;
+
+    ~ScopedTimer() {
+        if (active_) {
+            const auto duration = std::chrono::steady_clock::now() - start_;
+            detail::Record(timer_, static_cast<uint64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count()));
+        }
+    }
+
+private:
+    Timer timer_;
+    bool active_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+// документ JSON со всеми счетчиками и таймерами. времена в миллисекундах,
+// процентили - верхние границы интервалов гистограммы
+void WriteJson(std::ostream & out);
+
+} // namespace metrics
+
+#define METRICS_CONCAT_IMPL(a, b) a##b
+#define METRICS_CONCAT(a, b) METRICS_CONCAT_IMPL(a, b)
+
+#ifdef TC_METRICS
+#define METRICS_SCOPE(timer) ::metrics::ScopedTimer METRICS_CONCAT(metrics_scope_, __LINE__)(timer)
+#define METRICS_ADD(counter, value) ::metrics::Add((counter), (value))
+#else
+#define METRICS_SCOPE(timer) static_cast<void>(0)
+#define METRICS_ADD(counter, value) static_cast<void>(sizeof(value))
+#endif
@@ -5,6 +5,7 @@
 #include "router.h"
 #include "ranges.h"
 #include "transport_router.h"
+#include "metrics.h"
 #include <cassert>
 #include <sstream>
 #include <unordered_map>
@@ -18,66 +19,159 @@ RequestHandler::RequestHandler(tcatalogue::TransportCatalogue & db,
     : db_(db)
     , drawer_(drawer)
     , route_graph_(new RouteGraph(db, routing_settings))
-{}
+{
+    if (routing_settings.route_cache_kb != 0) {
+        route_cache_ = std::make_unique<RouteCache>(routing_settings.route_cache_kb * 1024);
+    }
+}
 
-const domain::Bus& RequestHandler::GetBus(domain::BusId id) const {
+const domain::Bus& RequestHandler::GetBus(std::string_view id) const {
     return db_.GetBus(id);
 }
 
-domain::StopBusesOpt RequestHandler::GetStopBuses(std::string_view stop_name) const {
-    return db_.GetStopBuses(stop_name);
+domain::BusStats RequestHandler::GetBusStats(const domain::Bus & bus) const {
+    return db_.GetBusStats(bus);
 }
 
-std::vector<const domain::Bus*> RequestHandler::GetAllBuses() const {
-    std::vector<const domain::Bus*> result;
-    for (const auto bus_id : db_) {
-        result.push_back(db_.GetBusPtr(bus_id));
-    }
-    return result;
+std::optional<domain::StopBusNames> RequestHandler::GetStopBusNames(std::string_view stop_name) const {
+    return db_.GetStopBusNames(stop_name);
 }
 
-// расчитываем географическую и актуальную дистанцию для маршрута, указанного автобуса.
-std::pair<double, double> RequestHandler::CalculateRouteLength(const domain::Bus & bus) const {
-    double geographical = 0.0;
-    double actual = 0.0;
-    const auto & v = bus.stops;
-    assert(v.size() >= 2);
-    for (size_t i = 0; i + 1 < v.size(); ++i) {
-        const Stop* pStopA = v[i];
-        const Stop* pStopB = v[i+1];
-        double distance = ComputeDistance( pStopA->coordinates, pStopB->coordinates );
-        geographical += distance;
-        size_t meters = db_.GetDistanceBetween( pStopA, pStopB );
-        actual += meters;
-    }
-    if (bus.is_round_trip == false) {
-        geographical *= 2;
-        for (size_t i = v.size()-1; i > 0; --i) {
-            const Stop* pStopA = v[i];
-            const Stop* pStopB = v[i-1];
-            size_t meters = db_.GetDistanceBetween( pStopA, pStopB );
-            actual += meters;
-        }
-    }
-    return std::make_pair(geographical, actual);
+std::vector<const domain::Bus*> RequestHandler::GetAllBuses() const {
+    return std::vector<const domain::Bus*>(db_.begin(), db_.end());
 }
 
-std::string RequestHandler::DrawMap() const {
+std::string RequestHandler::RenderMap() const {
+    METRICS_SCOPE(metrics::Timer::MAP_RENDER);
     std::stringstream stream;
     svg::Document doc = drawer_.Render( GetAllBuses() );
     doc.Render(stream);
     return stream.str();
 }
 
+std::shared_ptr<const std::string> RequestHandler::DrawMap() const {
+    bool rendered = false;
+    std::call_once(map_rendered_, [this, &rendered]() {
+        if (!map_) {
+            map_ = std::make_shared<const std::string>(RenderMap());
+            rendered = true;
+        }
+    });
+    if (!rendered) {
+        METRICS_ADD(metrics::Counter::MAP_CACHE_HITS, 1);
+    }
+    return map_;
+}
+
+void RequestHandler::LoadRenderedMap(std::string map) {
+    map_ = std::make_shared<const std::string>(std::move(map));
+}
+
+bool RequestHandler::LoadRouteGraph(RouteGraph::Snapshot snapshot) {
+    return route_graph_->Load(std::move(snapshot));
+}
+
+void RequestHandler::PrepareRouteGraph() const {
+    // строим один раз, даже если запросы обрабатываются в нескольких потоках
+    std::call_once(route_graph_prepared_, [this]() {
+        if (!route_graph_->isPrepared()) {
+            route_graph_->Prepare();
+        }
+    });
+}
+
 bool RequestHandler::HandleRoute(const domain::STAT_REQ_ROUTE & route_request,
                                  domain::STAT_RESP_ROUTE & route_response) const {
-    if (!route_graph_->isPrepared()) {
-        route_graph_->Prepare();
+    PrepareRouteGraph();
+    const domain::Stop * from = db_.GetStop(route_request.from_);
+    const domain::Stop * to = db_.GetStop(route_request.to_);
+    if (from == nullptr || to == nullptr) {
+        return false;
+    }
+    if (route_cache_) {
+        if (std::optional<RouteCache::Route> cached = route_cache_->Find(from->index, to->index)) {
+            route_response.route = std::move(cached.value());
+            return route_response.route != nullptr;
+        }
     }
     RouteGraph::ROUTER::RouteInfo route_info;
-    if (route_graph_->Build(route_request.from_, route_request.to_, route_info)) {
-        route_graph_->FillResponse(route_info, route_response);
-        return true;
+    std::shared_ptr<domain::STAT_ROUTE> route;
+    if (route_graph_->Build(from, to, route_info)) {
+        route = std::make_shared<domain::STAT_ROUTE>();
+        route_graph_->FillResponse(route_info, *route);
+    }
+    if (route_cache_) {
+        route_cache_->Insert(from->index, to->index, route);
+    }
+    route_response.route = std::move(route);
+    return route_response.route != nullptr;
+}
+
+void RequestHandler::HandleRoutesFrom(const domain::STAT_REQ_ROUTE * const * requests, size_t count,
+                                      domain::STAT_RESP_ROUTE * responses) const {
+    PrepareRouteGraph();
+    for (size_t i = 0; i < count; ++i) {
+        responses[i].route.reset();
+    }
+    const domain::Stop * from = (count != 0) ? db_.GetStop(requests[0]->from_) : nullptr;
+    if (from == nullptr) {
+        return;
+    }
+    // различные остановки назначения, ответов для которых нет в кеше
+    static constexpr size_t NO_TARGET = std::numeric_limits<size_t>::max();
+    std::vector<const domain::Stop*> targets;
+    std::vector<size_t> target_of_request(count, NO_TARGET);
+    std::unordered_map<size_t, size_t> target_of_stop;
+    for (size_t i = 0; i < count; ++i) {
+        assert(requests[i]->from_ == requests[0]->from_);
+        const domain::Stop * to = db_.GetStop(requests[i]->to_);
+        if (to == nullptr) {
+            continue;
+        }
+        if (auto it = target_of_stop.find(to->index); it != target_of_stop.end()) {
+            target_of_request[i] = it->second;
+            continue;
+        }
+        if (route_cache_) {
+            if (std::optional<RouteCache::Route> cached = route_cache_->Find(from->index, to->index)) {
+                responses[i].route = std::move(cached.value());
+                continue;
+            }
+        }
+        target_of_request[i] = targets.size();
+        target_of_stop.emplace(to->index, targets.size());
+        targets.push_back(to);
+    }
+    if (targets.empty()) {
+        return;
+    }
+
+    std::vector<std::optional<RouteGraph::ROUTER::RouteInfo>> route_infos = route_graph_->BuildFrom(from, targets);
+    std::vector<std::shared_ptr<const domain::STAT_ROUTE>> routes(targets.size());
+    for (size_t t = 0; t < targets.size(); ++t) {
+        if (route_infos[t].has_value()) {
+            auto route = std::make_shared<domain::STAT_ROUTE>();
+            route_graph_->FillResponse(route_infos[t].value(), *route);
+            routes[t] = std::move(route);
+        }
+        if (route_cache_) {
+            route_cache_->Insert(from->index, targets[t]->index, routes[t]);
+        }
+    }
+    for (size_t i = 0; i < count; ++i) {
+        if (target_of_request[i] != NO_TARGET) {
+            responses[i].route = routes[target_of_request[i]];
+        }
+    }
+}
+
+bool RequestHandler::GroupsRoutesByOrigin() const {
+    return route_graph_->HasOneToMany();
+}
+
+std::optional<RouteCache::Stats> RequestHandler::GetRouteCacheStats() const {
+    if (!route_cache_) {
+        return std::nullopt;
     }
-    return false;
+    return route_cache_->GetStats();
 }
@@ -5,32 +5,66 @@
 #include "map_renderer.h"
 #include "graph.h"
 #include "router.h"
+#include "transport_router.h"
+#include "route_cache.h"
 #include <memory>
+#include <mutex>
 #include <limits>
 
-class RouteGraph;
-
 class RequestHandler {
     tcatalogue::TransportCatalogue & db_;
     renderer::MapRenderer & drawer_;
 
     mutable std::shared_ptr<RouteGraph> route_graph_;
+    mutable std::once_flag route_graph_prepared_;
+    // ответы Route по паре остановок, nullptr - без кеша
+    std::unique_ptr<RouteCache> route_cache_;
+
+    // карта зависит только от каталога и настроек отрисовки, поэтому
+    // рисуется один раз и разделяется между всеми запросами
+    mutable std::shared_ptr<const std::string> map_;
+    mutable std::once_flag map_rendered_;
+
+    std::string RenderMap() const;
+
+    // граф, не загруженный из базы, строится при первом запросе Route
+    void PrepareRouteGraph() const;
 
 public:
     RequestHandler(tcatalogue::TransportCatalogue & db,
                    renderer::MapRenderer & drawer,
                    const domain::RoutingSettings &routing_settings);
 
-    const domain::Bus& GetBus(domain::BusId id) const;
+    const domain::Bus& GetBus(std::string_view id) const;
+    domain::BusStats GetBusStats(const domain::Bus & bus) const;
 
-    domain::StopBusesOpt GetStopBuses(std::string_view stop_name) const;
+    std::optional<domain::StopBusNames> GetStopBusNames(std::string_view stop_name) const;
 
-    std::pair<double, double> CalculateRouteLength(const domain::Bus & bus) const;
 
     std::vector<const domain::Bus*> GetAllBuses() const;
 
-    std::string DrawMap() const;
+    std::shared_ptr<const std::string> DrawMap() const;
+
+    // используем карту, отрисованную при создании базы
+    void LoadRenderedMap(std::string map);
 
+    // используем граф, подготовленный при создании базы. false, если граф
+    // не подходит к каталогу
+    bool LoadRouteGraph(RouteGraph::Snapshot snapshot);
+
+    // все методы, кроме Load*(), можно вызывать из нескольких потоков
     bool HandleRoute(const domain::STAT_REQ_ROUTE & route_request,
                      domain::STAT_RESP_ROUTE & route_response) const;
+
+    // ответы на count запросов Route с общей начальной остановкой одним
+    // поиском от нее. ответ на requests[i] пишется в responses[i], пустой
+    // route - маршрута нет
+    void HandleRoutesFrom(const domain::STAT_REQ_ROUTE * const * requests, size_t count,
+                          domain::STAT_RESP_ROUTE * responses) const;
+
+    // HandleRoutesFrom() отвечает на группу быстрее, чем HandleRoute() по одному
+    bool GroupsRoutesByOrigin() const;
+
+    // пусто, если кеш ответов Route отключен в routing_settings
+    std::optional<RouteCache::Stats> GetRouteCacheStats() const;
 };
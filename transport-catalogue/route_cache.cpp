@@ -0,0 +1,65 @@
+#include "route_cache.h"
+
+#include "metrics.h"
+
+RouteCache::RouteCache(size_t capacity_bytes)
+    : capacity_bytes_(capacity_bytes)
+{
+    stats_.capacity_bytes = capacity_bytes;
+}
+
+// узел списка и узел хеш-таблицы с корзиной, а для найденного маршрута
+// еще его элементы и блок управления shared_ptr
+size_t RouteCache::EntryBytes(const Route & route) {
+    size_t bytes = sizeof(Entry) + 2 * sizeof(void*)
+                 + sizeof(std::pair<const uint64_t, std::list<Entry>::iterator>) + 3 * sizeof(void*);
+    if (route) {
+        bytes += sizeof(domain::STAT_ROUTE) + 2 * sizeof(long)
+               + route->items.capacity() * sizeof(domain::STAT_RESP_ROUTE_ITEM);
+    }
+    return bytes;
+}
+
+std::optional<RouteCache::Route> RouteCache::Find(uint32_t from, uint32_t to) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    auto it = index_.find(Key(from, to));
+    if (it == index_.end()) {
+        ++stats_.misses;
+        METRICS_ADD(metrics::Counter::ROUTE_CACHE_MISSES, 1);
+        return std::nullopt;
+    }
+    ++stats_.hits;
+    METRICS_ADD(metrics::Counter::ROUTE_CACHE_HITS, 1);
+    entries_.splice(entries_.begin(), entries_, it->second);
+    return it->second->route;
+}
+
+void RouteCache::Insert(uint32_t from, uint32_t to, Route route) {
+    const size_t bytes = EntryBytes(route);
+    if (bytes > capacity_bytes_) {
+        return;
+    }
+    const uint64_t key = Key(from, to);
+    std::lock_guard<std::mutex> guard(mutex_);
+    // ответ мог посчитать и вставить другой поток
+    if (index_.count(key) != 0) {
+        return;
+    }
+    while (stats_.bytes + bytes > capacity_bytes_) {
+        const Entry & oldest = entries_.back();
+        stats_.bytes -= oldest.bytes;
+        index_.erase(oldest.key);
+        entries_.pop_back();
+        ++stats_.evictions;
+    }
+    entries_.push_front({key, std::move(route), bytes});
+    index_.emplace(key, entries_.begin());
+    stats_.bytes += bytes;
+}
+
+RouteCache::Stats RouteCache::GetStats() const {
+    std::lock_guard<std::mutex> guard(mutex_);
+    Stats stats = stats_;
+    stats.entries = entries_.size();
+    return stats;
+}
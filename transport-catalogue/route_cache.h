@@ -0,0 +1,55 @@
+#pragma once
+
+#include "domain.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+
+// Кеш готовых ответов на запросы Route по паре остановок с вытеснением
+// давно не запрошенных. Размер ограничен оценкой занятой памяти, а не
+// числом записей: длинный маршрут стоит дороже короткого. Запоминается
+// и отсутствие маршрута. Методы можно вызывать из нескольких потоков.
+class RouteCache {
+public:
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t evictions = 0;
+        size_t entries = 0;
+        size_t bytes = 0;
+        size_t capacity_bytes = 0;
+    };
+
+    using Route = std::shared_ptr<const domain::STAT_ROUTE>;
+
+    explicit RouteCache(size_t capacity_bytes);
+
+    // nullopt - ответа нет в кеше, nullptr - маршрута между остановками нет
+    std::optional<Route> Find(uint32_t from, uint32_t to);
+    void Insert(uint32_t from, uint32_t to, Route route);
+
+    Stats GetStats() const;
+
+private:
+    struct Entry {
+        uint64_t key;
+        Route route;
+        size_t bytes;
+    };
+
+    static uint64_t Key(uint32_t from, uint32_t to) {
+        return (static_cast<uint64_t>(from) << 32) | to;
+    }
+    static size_t EntryBytes(const Route & route);
+
+    const size_t capacity_bytes_;
+    mutable std::mutex mutex_;
+    std::list<Entry> entries_; // в начале - последние запрошенные
+    std::unordered_map<uint64_t, std::list<Entry>::iterator> index_;
+    Stats stats_;
+};
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "metrics.h"
+
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+// Пул рабочих массивов поиска. Маршрутизатор берет из пула свободный
+// экземпляр на время одного запроса, поэтому запросы из разных потоков не
+// мешают друг другу, а в однопоточном режиме один и тот же экземпляр
+// переиспользуется без повторного выделения памяти.
+template <typename Scratch>
+class ScratchPool {
+public:
+    // экземпляр, занятый на время запроса. при уничтожении возвращается в пул
+    class Lease {
+    public:
+        Lease(ScratchPool& pool, std::unique_ptr<Scratch> scratch)
+            : pool_(pool)
+            , scratch_(std::move(scratch))
+        {}
+
+        Lease(const Lease&) = delete;
+        Lease& operator=(const Lease&) = delete;
+
+        ~Lease() {
+            pool_.Release(std::move(scratch_));
+        }
+
+        Scratch& operator*() const {
+            return *scratch_;
+        }
+
+        Scratch* operator->() const {
+            return scratch_.get();
+        }
+
+    private:
+        ScratchPool& pool_;
+        std::unique_ptr<Scratch> scratch_;
+    };
+
+    ScratchPool() = default;
+    ScratchPool(const ScratchPool&) = delete;
+    ScratchPool& operator=(const ScratchPool&) = delete;
+
+    // берем свободный экземпляр, а если его нет - создаем новый и
+    // подготавливаем функцией init(Scratch&)
+    template <typename Init>
+    Lease Acquire(Init init) {
+        {
+            std::lock_guard<std::mutex> guard(mutex_);
+            if (!free_.empty()) {
+                std::unique_ptr<Scratch> scratch = std::move(free_.back());
+                free_.pop_back();
+                METRICS_ADD(metrics::Counter::SCRATCH_REUSED, 1);
+                return Lease(*this, std::move(scratch));
+            }
+        }
+        METRICS_ADD(metrics::Counter::SCRATCH_ALLOCATED, 1);
+        auto scratch = std::make_unique<Scratch>();
+        init(*scratch);
+        return Lease(*this, std::move(scratch));
+    }
+
+private:
+    void Release(std::unique_ptr<Scratch> scratch) {
+        std::lock_guard<std::mutex> guard(mutex_);
+        free_.push_back(std::move(scratch));
+    }
+
+    std::mutex mutex_;
+    std::vector<std::unique_ptr<Scratch>> free_;
+};
+
+}  // namespace graph
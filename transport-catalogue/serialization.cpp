@@ -1,10 +1,17 @@
 #include "serialization.h"
 
 #include "domain.h"
+#include "metrics.h"
 
 #include <transport_catalogue.pb.h>
 #include <cassert>
 #include <fstream>
+#include <limits>
+#include <string_view>
+#include <unordered_map>
+
+// схема 2: остановки в маршрутах и расстояниях заданы номером, а не именем
+static constexpr uint32_t SCHEMA_VERSION = 2;
 
 const std::string& Serialization::GetFilePath(const Context &ctx) {
     assert(ctx.serialize_settings.has_value());
@@ -54,35 +61,213 @@ void svgColorDeserialize(const ::transport_catalogue_pb::Color & in_color,
     }
 }
 
-void Serialization::Write(const Context & context) {
-    ::transport_catalogue_pb::Catalogue cat;
-    // stops
-    for (const domain::STOP & stop : context.stops) {
-        ::transport_catalogue_pb::Stop* pbStop = cat.add_stops();
-        pbStop->set_name(stop.stop_name_);
-        pbStop->set_lat(stop.coordinates_.lat);
-        pbStop->set_lng(stop.coordinates_.lng);
-        for (const std::pair<std::string, size_t> & pair : stop.distances_) {
-            ::transport_catalogue_pb::Distance* pbDistance = pbStop->add_road_distances();
-            pbDistance->set_name(pair.first);
-            pbDistance->set_distance(pair.second);
+void hierarchySerialize(const RouteGraph::CH_ROUTER::Hierarchy & in_hierarchy,
+                        ::transport_catalogue_pb::ContractionHierarchy & out_hierarchy) {
+    out_hierarchy.Clear();
+    out_hierarchy.mutable_rank()->Reserve(static_cast<int>(in_hierarchy.ranks.size()));
+    for (size_t rank : in_hierarchy.ranks) {
+        out_hierarchy.add_rank(rank);
+    }
+    const int shortcut_count = static_cast<int>(in_hierarchy.shortcuts.size());
+    out_hierarchy.mutable_shortcut_from()->Reserve(shortcut_count);
+    out_hierarchy.mutable_shortcut_to()->Reserve(shortcut_count);
+    out_hierarchy.mutable_shortcut_weight()->Reserve(shortcut_count);
+    out_hierarchy.mutable_shortcut_first()->Reserve(shortcut_count);
+    out_hierarchy.mutable_shortcut_second()->Reserve(shortcut_count);
+    for (const auto & shortcut : in_hierarchy.shortcuts) {
+        out_hierarchy.add_shortcut_from(shortcut.from);
+        out_hierarchy.add_shortcut_to(shortcut.to);
+        out_hierarchy.add_shortcut_weight(shortcut.weight);
+        out_hierarchy.add_shortcut_first(shortcut.first);
+        out_hierarchy.add_shortcut_second(shortcut.second);
+    }
+}
+
+bool hierarchyDeserialize(const ::transport_catalogue_pb::ContractionHierarchy & in_hierarchy,
+                          RouteGraph::CH_ROUTER::Hierarchy & out_hierarchy) {
+    const int shortcut_count = in_hierarchy.shortcut_from_size();
+    if (in_hierarchy.shortcut_to_size() != shortcut_count
+            || in_hierarchy.shortcut_weight_size() != shortcut_count
+            || in_hierarchy.shortcut_first_size() != shortcut_count
+            || in_hierarchy.shortcut_second_size() != shortcut_count) {
+        return false;
+    }
+    out_hierarchy.ranks.assign(in_hierarchy.rank().begin(), in_hierarchy.rank().end());
+    out_hierarchy.shortcuts.clear();
+    out_hierarchy.shortcuts.reserve(shortcut_count);
+    for (int i = 0; i < shortcut_count; ++i) {
+        out_hierarchy.shortcuts.push_back({in_hierarchy.shortcut_from(i),
+                                           in_hierarchy.shortcut_to(i),
+                                           in_hierarchy.shortcut_weight(i),
+                                           in_hierarchy.shortcut_first(i),
+                                           in_hierarchy.shortcut_second(i)});
+    }
+    return true;
+}
+
+void routeGraphSerialize(const RouteGraph::Snapshot & in_graph,
+                         ::transport_catalogue_pb::RouteGraph & out_graph) {
+    out_graph.Clear();
+    out_graph.set_vertex_count(in_graph.vertex_count);
+    for (const auto & vertex : in_graph.vertices) {
+        auto * pbVertex = out_graph.add_vertices();
+        pbVertex->set_stop(vertex.stop_index);
+        pbVertex->set_waiting(vertex.idx_waiting);
+        if (vertex.idx_arrive != std::numeric_limits<graph::VertexId>::max()) {
+            pbVertex->set_arrive(vertex.idx_arrive);
         }
     }
-    // busses
-    for (const domain::BUS & bus : context.busses) {
-        ::transport_catalogue_pb::Bus* pbBus = cat.add_buses();
-        pbBus->set_bus_id(std::string(bus.bus_id_));
-        pbBus->set_is_round_trip(bus.is_round_trip_);
-        for (const std::string & stop_name : bus.stops_) {
-            pbBus->add_stops(stop_name);
+    const int edge_count = static_cast<int>(in_graph.edges.size());
+    out_graph.mutable_edge_from()->Reserve(edge_count);
+    out_graph.mutable_edge_to()->Reserve(edge_count);
+    out_graph.mutable_edge_weight()->Reserve(edge_count);
+    out_graph.mutable_edge_type()->Reserve(edge_count);
+    out_graph.mutable_edge_index()->Reserve(edge_count);
+    out_graph.mutable_edge_span_count()->Reserve(edge_count);
+    for (int i = 0; i < edge_count; ++i) {
+        const RouteGraph::Ed & edge = in_graph.edges[i];
+        const RouteGraph::Snapshot::EdgeInfo & info = in_graph.edge_infos[i];
+        out_graph.add_edge_from(edge.from);
+        out_graph.add_edge_to(edge.to);
+        out_graph.add_edge_weight(edge.weight);
+        out_graph.add_edge_type(static_cast<::transport_catalogue_pb::RouteGraph::EdgeType>(info.type));
+        out_graph.add_edge_index(info.index);
+        out_graph.add_edge_span_count(info.span_count);
+    }
+    if (in_graph.routes_internal_data.has_value()) {
+        auto * pbRouter = out_graph.mutable_router_data();
+        const auto & routes = in_graph.routes_internal_data.value();
+        const size_t cells = in_graph.vertex_count * in_graph.vertex_count;
+        if (cells <= static_cast<size_t>(std::numeric_limits<int>::max())) {
+            pbRouter->mutable_weight()->Reserve(static_cast<int>(cells));
+            pbRouter->mutable_prev_edge()->Reserve(static_cast<int>(cells));
+        }
+        for (const auto & row : routes) {
+            for (const auto & route : row) {
+                pbRouter->add_weight(route ? route->weight : -1.0);
+                pbRouter->add_prev_edge(route && route->prev_edge ? *route->prev_edge + 1 : 0);
+            }
+        }
+    }
+    if (in_graph.hierarchy.has_value()) {
+        hierarchySerialize(in_graph.hierarchy.value(), *out_graph.mutable_hierarchy());
+    }
+}
+
+// false, если столбцы разной длины или номера выходят за пределы графа и каталога
+bool routeGraphDeserialize(const ::transport_catalogue_pb::RouteGraph & in_graph,
+                           size_t stop_count, size_t bus_count,
+                           RouteGraph::Snapshot & out_graph) {
+    out_graph.vertex_count = in_graph.vertex_count();
+    out_graph.vertices.clear();
+    out_graph.vertices.reserve(in_graph.vertices_size());
+    for (const auto & pbVertex : in_graph.vertices()) {
+        out_graph.vertices.push_back({pbVertex.stop(),
+                                      pbVertex.waiting(),
+                                      pbVertex.has_arrive() ? pbVertex.arrive()
+                                                            : std::numeric_limits<graph::VertexId>::max()});
+    }
+    const int edge_count = in_graph.edge_from_size();
+    if (in_graph.edge_to_size() != edge_count
+            || in_graph.edge_weight_size() != edge_count
+            || in_graph.edge_type_size() != edge_count
+            || in_graph.edge_index_size() != edge_count
+            || in_graph.edge_span_count_size() != edge_count) {
+        return false;
+    }
+    out_graph.edges.clear();
+    out_graph.edges.reserve(edge_count);
+    out_graph.edge_infos.clear();
+    out_graph.edge_infos.reserve(edge_count);
+    for (int i = 0; i < edge_count; ++i) {
+        out_graph.edges.push_back({in_graph.edge_from(i), in_graph.edge_to(i), in_graph.edge_weight(i)});
+        out_graph.edge_infos.push_back({static_cast<RouteGraph::EDGE_TYPE>(in_graph.edge_type(i)),
+                                        in_graph.edge_index(i),
+                                        in_graph.edge_span_count(i)});
+    }
+    out_graph.routes_internal_data.reset();
+    if (in_graph.has_router_data()) {
+        const auto & pbRouter = in_graph.router_data();
+        const size_t vertex_count = out_graph.vertex_count;
+        // размер таблицы проверяем до выделения памяти под нее
+        const size_t cells = static_cast<size_t>(pbRouter.weight_size());
+        if (vertex_count * vertex_count != cells || (vertex_count != 0 && cells / vertex_count != vertex_count)
+                || pbRouter.prev_edge_size() != pbRouter.weight_size()) {
+            return false;
+        }
+        using RouteInternalData = RouteGraph::ROUTER::RouteInternalData;
+        RouteGraph::ROUTER::RoutesInternalData routes(
+            vertex_count, std::vector<std::optional<RouteInternalData>>(vertex_count));
+        int cell = 0;
+        for (auto & row : routes) {
+            for (auto & route : row) {
+                const double weight = pbRouter.weight(cell);
+                const uint64_t prev_edge = pbRouter.prev_edge(cell);
+                if (weight >= 0.0) {
+                    route = RouteInternalData{weight, std::nullopt};
+                    if (prev_edge != 0) {
+                        route->prev_edge = prev_edge - 1;
+                    }
+                }
+                ++cell;
+            }
         }
+        out_graph.routes_internal_data = std::move(routes);
     }
+    out_graph.hierarchy.reset();
+    if (in_graph.has_hierarchy()) {
+        RouteGraph::CH_ROUTER::Hierarchy hierarchy;
+        if (!hierarchyDeserialize(in_graph.hierarchy(), hierarchy)) {
+            return false;
+        }
+        out_graph.hierarchy = std::move(hierarchy);
+    }
+    return out_graph.IsValid(stop_count, bus_count);
+}
+
+void busStatsSerialize(const std::vector<domain::BusStats> & in_stats,
+                       ::transport_catalogue_pb::BusStats & out_stats) {
+    const int count = static_cast<int>(in_stats.size());
+    out_stats.mutable_geo_length()->Reserve(count);
+    out_stats.mutable_route_length()->Reserve(count);
+    out_stats.mutable_stop_count()->Reserve(count);
+    out_stats.mutable_unique_stop_count()->Reserve(count);
+    for (const domain::BusStats & stats : in_stats) {
+        out_stats.add_geo_length(stats.geo_length);
+        out_stats.add_route_length(stats.route_length);
+        out_stats.add_stop_count(stats.stop_count);
+        out_stats.add_unique_stop_count(stats.unique_stop_count);
+    }
+}
+
+bool busStatsDeserialize(const ::transport_catalogue_pb::BusStats & in_stats,
+                         std::vector<domain::BusStats> & out_stats) {
+    const int count = in_stats.geo_length_size();
+    if (in_stats.route_length_size() != count || in_stats.stop_count_size() != count
+            || in_stats.unique_stop_count_size() != count) {
+        return false;
+    }
+    out_stats.clear();
+    out_stats.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        out_stats.push_back({in_stats.geo_length(i), in_stats.route_length(i),
+                             in_stats.stop_count(i), in_stats.unique_stop_count(i)});
+    }
+    return true;
+}
+
+// настройки маршрутизации и отрисовки
+void settingsSerialize(const Serialization::Context & context,
+                       ::transport_catalogue_pb::Catalogue & cat) {
     // routing settings
     if (context.routing_settings.has_value()) {
         const auto & rs = context.routing_settings.value();
         ::transport_catalogue_pb::RoutingSettings* pbRS = cat.mutable_routing_settings();
         pbRS->set_bus_velocity(rs.bus_velocity);
         pbRS->set_bus_wait_time(rs.bus_wait_time);
+        pbRS->set_router_type(static_cast<::transport_catalogue_pb::RoutingSettings::RouterType>(rs.router_type));
+        pbRS->set_graph_model(static_cast<::transport_catalogue_pb::RoutingSettings::GraphModel>(rs.graph_model));
+        pbRS->set_route_cache_kb(static_cast<uint32_t>(rs.route_cache_kb));
     }
     // render settings
     if (context.render_settings.has_value()) {
@@ -111,55 +296,21 @@ void Serialization::Write(const Context & context) {
             svgColorSerialize(color, *pb_color_palette);
         }
     }
-
-    // output to file stream
-    std::ofstream output_file(GetFilePath(context), std::ios::binary);
-    cat.SerializeToOstream(&output_file);
 }
 
-bool Serialization::Read(Context & context) {
-    // input from file stream
-    std::ifstream input_file(GetFilePath(context), std::ios::binary);
-
-    ::transport_catalogue_pb::Catalogue cat;
-    if (!cat.ParseFromIstream(&input_file)) {
-        return false;
-    }
-
-    context.stops.clear();
-    for (int i = 0; i < cat.stops_size(); ++i) {
-        domain::STOP stop;
-        const ::transport_catalogue_pb::Stop& ref_stop = cat.stops(i);
-        stop.stop_name_ = ref_stop.name();
-        stop.coordinates_.lat = ref_stop.lat();
-        stop.coordinates_.lng = ref_stop.lng();
-
-        for (int j = 0; j < ref_stop.road_distances_size(); ++j) {
-            const ::transport_catalogue_pb::Distance& ref_dist = ref_stop.road_distances(j);
-            stop.distances_.emplace_back(ref_dist.name(), ref_dist.distance());
-        }
-        context.stops.emplace_back(std::move(stop));
-    }
-
-    context.busses.clear();
-    for (int i = 0; i < cat.buses_size(); ++i) {
-        domain::BUS bus;
-        const ::transport_catalogue_pb::Bus& ref_bus = cat.buses(i);
-        bus.bus_id_ = ref_bus.bus_id();
-        bus.is_round_trip_ = ref_bus.is_round_trip();
-        for (int j = 0; j < ref_bus.stops_size(); ++j) {
-            const std::string & stop_name = ref_bus.stops(j);
-            bus.stops_.emplace_back(stop_name);
-        }
-        context.busses.emplace_back(std::move(bus));
-    }
-
+void settingsDeserialize(const ::transport_catalogue_pb::Catalogue & cat,
+                         Serialization::Context & context) {
     // routing settings
     if (cat.has_routing_settings()) {
         const auto & pbRS = cat.routing_settings();
         domain::RoutingSettings routing_settings;
         routing_settings.bus_velocity = pbRS.bus_velocity();
         routing_settings.bus_wait_time = pbRS.bus_wait_time();
+        routing_settings.router_type = static_cast<domain::RouterType>(pbRS.router_type());
+        routing_settings.graph_model = static_cast<domain::GraphModel>(pbRS.graph_model());
+        if (pbRS.has_route_cache_kb()) {
+            routing_settings.route_cache_kb = pbRS.route_cache_kb();
+        }
         context.routing_settings = std::move(routing_settings);
     }
 
@@ -191,5 +342,217 @@ bool Serialization::Read(Context & context) {
         }
         context.render_settings = std::move(render_settings);
     }
+}
+
+void Serialization::Write(const Context & context) {
+    METRICS_SCOPE(metrics::Timer::BASE_WRITE);
+    if (context.serialize_settings.has_value()
+            && context.serialize_settings->format == domain::BaseFormat::FLAT) {
+        WriteFlat(context);
+        return;
+    }
+
+    ::transport_catalogue_pb::Catalogue cat;
+    cat.set_schema_version(SCHEMA_VERSION);
+    // остановки и маршруты ссылаются на остановки по номеру - позиции в
+    // cat.stops, куда попадают и повторы. повторное имя получает номер первого
+    // вхождения: при чтении они все равно сводятся к одной остановке каталога
+    std::unordered_map<std::string_view, uint32_t> stop_indices;
+    stop_indices.reserve(context.stops.size());
+    uint32_t stop_position = 0;
+    for (const domain::STOP & stop : context.stops) {
+        stop_indices.emplace(stop.stop_name_, stop_position++);
+    }
+    // ссылки на неизвестные остановки не сохраняются: каталог их все равно пропускает
+    auto find_stop = [&stop_indices](const std::string & name) -> const uint32_t* {
+        auto it = stop_indices.find(name);
+        return it == stop_indices.end() ? nullptr : &it->second;
+    };
+    // stops
+    for (const domain::STOP & stop : context.stops) {
+        ::transport_catalogue_pb::Stop* pbStop = cat.add_stops();
+        pbStop->set_name(stop.stop_name_);
+        pbStop->set_lat(stop.coordinates_.lat);
+        pbStop->set_lng(stop.coordinates_.lng);
+        for (const auto & [name, meters] : stop.distances_) {
+            if (const uint32_t * index = find_stop(name); index != nullptr) {
+                pbStop->add_distance_stop(*index);
+                pbStop->add_distance_meters(static_cast<uint32_t>(meters));
+            }
+        }
+    }
+    // busses
+    for (const domain::BUS & bus : context.busses) {
+        ::transport_catalogue_pb::Bus* pbBus = cat.add_buses();
+        pbBus->set_bus_id(std::string(bus.bus_id_));
+        pbBus->set_is_round_trip(bus.is_round_trip_);
+        pbBus->mutable_stop_index()->Reserve(static_cast<int>(bus.stops_.size()));
+        for (const std::string & stop_name : bus.stops_) {
+            if (const uint32_t * index = find_stop(stop_name); index != nullptr) {
+                pbBus->add_stop_index(*index);
+            }
+        }
+    }
+    settingsSerialize(context, cat);
+
+    // prepared route graph
+    if (context.route_graph.has_value()) {
+        routeGraphSerialize(context.route_graph.value(), *cat.mutable_route_graph());
+    }
+
+    // показатели маршрутов
+    if (context.bus_stats.has_value()) {
+        busStatsSerialize(context.bus_stats.value(), *cat.mutable_bus_stats());
+    }
+
+    // rendered map
+    if (context.rendered_map.has_value()) {
+        cat.set_rendered_map(context.rendered_map.value());
+    }
+
+    // output to file stream
+    std::ofstream output_file(GetFilePath(context), std::ios::binary);
+    cat.SerializeToOstream(&output_file);
+}
+
+// чтение сообщения базы известной версии схемы
+bool catalogueRead(const std::string & path, ::transport_catalogue_pb::Catalogue & cat) {
+    std::ifstream input_file(path, std::ios::binary);
+    return cat.ParseFromIstream(&input_file) && cat.schema_version() <= SCHEMA_VERSION;
+}
+
+// настройки, граф маршрутов и карта. граф ссылается на stop_count
+// остановок и bus_count маршрутов каталога
+bool extrasDeserialize(::transport_catalogue_pb::Catalogue & cat, size_t stop_count, size_t bus_count,
+                       Serialization::Context & context) {
+    settingsDeserialize(cat, context);
+
+    // prepared route graph
+    context.route_graph.reset();
+    if (cat.has_route_graph()) {
+        RouteGraph::Snapshot route_graph;
+        if (!routeGraphDeserialize(cat.route_graph(), stop_count, bus_count, route_graph)) {
+            return false;
+        }
+        context.route_graph = std::move(route_graph);
+    }
+
+    // rendered map
+    context.rendered_map.reset();
+    if (cat.has_rendered_map()) {
+        context.rendered_map = std::move(*cat.mutable_rendered_map());
+    }
+
+    // показатели маршрутов. в старых базах их нет, тогда их считает каталог
+    context.bus_stats.reset();
+    std::vector<domain::BusStats> bus_stats;
+    if (cat.has_bus_stats() && busStatsDeserialize(cat.bus_stats(), bus_stats)) {
+        context.bus_stats = std::move(bus_stats);
+    }
+    return true;
+}
+
+// заполнение каталога прямо из сообщения, по тем же правилам, что и у
+// FillDatabase: повторная остановка обновляет координаты, для расстояний
+// берется последний непустой список остановки, неизвестные остановки
+// пропускаются. имена переносятся из сообщения без копирования
+bool catalogueLoad(::transport_catalogue_pb::Catalogue & cat, tcatalogue::TransportCatalogue & db) {
+    const bool by_index = (cat.schema_version() >= 2);
+    const size_t stop_count = static_cast<size_t>(cat.stops_size());
+    size_t distance_count = 0;
+    for (const auto & pbStop : cat.stops()) {
+        distance_count += pbStop.distance_stop_size() + pbStop.road_distances_size();
+    }
+    db.Reserve(stop_count, static_cast<size_t>(cat.buses_size()), distance_count);
+
+    std::vector<domain::Stop*> stops(stop_count); // остановка каталога по номеру в сообщении
+    std::vector<int> distances_source(stop_count, -1); // номер в сообщении по номеру в каталоге
+    for (size_t i = 0; i < stop_count; ++i) {
+        auto * pbStop = cat.mutable_stops(static_cast<int>(i));
+        stops[i] = db.AddStop(std::move(*pbStop->mutable_name()), {pbStop->lat(), pbStop->lng()});
+        if (pbStop->distance_stop_size() > 0 || pbStop->road_distances_size() > 0) {
+            distances_source[stops[i]->index] = static_cast<int>(i);
+        }
+    }
+
+    std::vector<size_t> stop_indices;
+    for (auto & pbBus : *cat.mutable_buses()) {
+        stop_indices.clear();
+        stop_indices.reserve(pbBus.stop_index_size() + pbBus.stops_size());
+        for (uint32_t index : pbBus.stop_index()) {
+            if (index >= stop_count) {
+                return false;
+            }
+            stop_indices.push_back(stops[index]->index);
+        }
+        for (const std::string & stop_name : pbBus.stops()) {
+            if (const domain::Stop * stop = db.GetStop(stop_name); stop != nullptr) {
+                stop_indices.push_back(stop->index);
+            }
+        }
+        db.AddBus(std::move(*pbBus.mutable_bus_id()), stop_indices, pbBus.is_round_trip());
+    }
+
+    for (size_t index = 0; index < db.StopCount(); ++index) {
+        if (distances_source[index] < 0) {
+            continue;
+        }
+        const auto & pbStop = cat.stops(distances_source[index]);
+        const domain::Stop * stop_from = db.GetStopByIndex(index);
+        if (by_index) {
+            if (pbStop.distance_stop_size() != pbStop.distance_meters_size()) {
+                return false;
+            }
+            for (int j = 0; j < pbStop.distance_stop_size(); ++j) {
+                if (pbStop.distance_stop(j) >= stop_count) {
+                    return false;
+                }
+                db.SetDistanceBetween(stop_from, stops[pbStop.distance_stop(j)], pbStop.distance_meters(j));
+            }
+        }
+        for (const auto & pbDistance : pbStop.road_distances()) {
+            if (const domain::Stop * stop_to = db.GetStop(pbDistance.name()); stop_to != nullptr) {
+                db.SetDistanceBetween(stop_from, stop_to, pbDistance.distance());
+            }
+        }
+    }
+    return true;
+}
+
+std::string Serialization::WriteSettings(const Context & context) {
+    ::transport_catalogue_pb::Catalogue cat;
+    settingsSerialize(context, cat);
+    return cat.SerializeAsString();
+}
+
+bool Serialization::ReadSettings(std::string_view data, Context & context) {
+    ::transport_catalogue_pb::Catalogue cat;
+    if (!cat.ParseFromArray(data.data(), static_cast<int>(data.size()))) {
+        return false;
+    }
+    settingsDeserialize(cat, context);
+    return true;
+}
+
+bool Serialization::Load(Context & context, tcatalogue::TransportCatalogue & db) {
+    METRICS_SCOPE(metrics::Timer::BASE_LOAD);
+    if (IsFlat(context)) {
+        return ReadFlat(context, db);
+    }
+    ::transport_catalogue_pb::Catalogue cat;
+    if (!catalogueRead(GetFilePath(context), cat) || !catalogueLoad(cat, db)) {
+        return false;
+    }
+    // остановки и маршруты уже в каталоге, освобождаем их до разбора графа
+    cat.clear_stops();
+    cat.clear_buses();
+    if (!extrasDeserialize(cat, db.StopCount(), db.BusCount(), context)) {
+        return false;
+    }
+    if (!context.bus_stats.has_value() || !db.SetBusStats(std::move(context.bus_stats.value()))) {
+        db.ComputeBusStats();
+    }
+    context.bus_stats.reset();
+    db.ComputeStopBusNames();
     return true;
 }
@@ -2,6 +2,12 @@
 
 #include "domain.h"
 #include "map_renderer.h"
+#include "transport_catalogue.h"
+#include "transport_router.h"
+
+#include <string>
+#include <string_view>
+#include <vector>
 
 class Serialization {
 public:
@@ -11,11 +17,27 @@ public:
         std::optional<domain::SerializeSettings> serialize_settings;
         std::optional<renderer::Settings> render_settings;
         std::optional<domain::RoutingSettings> routing_settings;
+        std::optional<RouteGraph::Snapshot> route_graph;
+        std::optional<std::string> rendered_map;
+        std::optional<std::vector<domain::BusStats>> bus_stats; // по порядковым номерам маршрутов каталога
     };
 
-    static bool Read(Context & context);
+    // формат записи задается serialize_settings.format
     static void Write(const Context & context);
 
+    // чтение базы сразу в каталог, без списков STOPS и BUSES. формат
+    // определяется по заголовку файла, плоская база отображается в память
+    static bool Load(Context & context, tcatalogue::TransportCatalogue & db);
+
 private:
     static const std::string& GetFilePath(const Context& ctx);
+
+    // настройки отрисовки и маршрутизации в виде сообщения Catalogue
+    static std::string WriteSettings(const Context & context);
+    static bool ReadSettings(std::string_view data, Context & context);
+
+    // плоский формат, serialization_flat.cpp
+    static bool IsFlat(const Context & context);
+    static void WriteFlat(const Context & context);
+    static bool ReadFlat(Context & context, tcatalogue::TransportCatalogue & db);
 };
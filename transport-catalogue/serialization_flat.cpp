@@ -0,0 +1,646 @@
+#include "serialization.h"
+
+#include "domain.h"
+#include "transport_catalogue.h"
+
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define TC_HAS_MMAP 1
+#endif
+
+// Плоский формат базы. Файл начинается с заголовка FlatHeader, за ним
+// идут секции из таблицы заголовка, каждая выровнена на 8 байт. Записи
+// секций - структуры фиксированного размера, поэтому отображенный в
+// память файл читается без разбора: остановки и маршруты ссылаются друг
+// на друга по порядковым номерам, имена лежат в общей таблице строк.
+// Числа хранятся в порядке байтов машины, записавшей базу; чтение на
+// машине с другим порядком байтов отклоняется. Версия 2 добавила секцию
+// показателей маршрутов, базы версии 1 читаются, показатели для них считаются.
+
+namespace {
+
+constexpr char FLAT_MAGIC[8] = {'T', 'C', 'F', 'L', 'A', 'T', '\0', '\0'};
+constexpr uint32_t FLAT_VERSION = 2;
+constexpr uint32_t FLAT_BYTE_ORDER = 0x01020304;
+constexpr uint64_t FLAT_NO_VERTEX = std::numeric_limits<uint64_t>::max();
+
+enum FlatSectionId : uint32_t {
+    SECTION_STRINGS,        // имена остановок и маршрутов подряд
+    SECTION_STOPS,          // FlatStop по порядковым номерам остановок
+    SECTION_BUSES,          // FlatBus по порядковым номерам маршрутов
+    SECTION_BUS_STOPS,      // uint32_t, номера остановок всех маршрутов подряд
+    SECTION_DISTANCES,      // FlatDistance
+    SECTION_SETTINGS,       // сообщение Catalogue только с настройками
+    SECTION_RENDERED_MAP,   // SVG карты
+    SECTION_GRAPH_VERTICES, // FlatVertex
+    SECTION_GRAPH_EDGES,    // FlatEdge, i-я запись - ребро с EdgeId == i
+    SECTION_ROUTER_DATA,    // FlatRoute, матрица Floyd–Warshall V×V построчно
+    SECTION_CH_RANKS,       // uint32_t, ранги вершин иерархии сжатия
+    SECTION_CH_SHORTCUTS,   // FlatShortcut
+    SECTION_BUS_STATS,      // FlatBusStats по порядковым номерам маршрутов, с версии 2
+    SECTION_COUNT,
+};
+
+// число секций в заголовке версии 1
+constexpr uint32_t FLAT_V1_SECTION_COUNT = SECTION_BUS_STATS;
+
+enum FlatFlags : uint32_t {
+    FLAG_ROUTE_GRAPH  = 1 << 0,
+    FLAG_ROUTER_DATA  = 1 << 1,
+    FLAG_HIERARCHY    = 1 << 2,
+    FLAG_RENDERED_MAP = 1 << 3,
+    FLAG_BUS_STATS    = 1 << 4,
+};
+
+struct FlatSection {
+    uint64_t offset = 0;
+    uint64_t size = 0;
+};
+
+struct FlatHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t flags;
+    uint32_t reserved;
+    uint64_t graph_vertex_count;
+    FlatSection sections[SECTION_COUNT];
+};
+
+struct FlatStop {
+    uint32_t name_offset;
+    uint32_t name_size;
+    double lat;
+    double lng;
+};
+
+struct FlatBus {
+    uint32_t name_offset;
+    uint32_t name_size;
+    uint32_t stops_begin; // первая остановка в SECTION_BUS_STOPS
+    uint32_t stops_count;
+    uint32_t is_round_trip;
+    uint32_t reserved;
+};
+
+struct FlatBusStats {
+    double geo_length;
+    uint64_t route_length;
+    uint32_t stop_count;
+    uint32_t unique_stop_count;
+};
+
+struct FlatDistance {
+    uint32_t from;
+    uint32_t to;
+    uint64_t meters;
+};
+
+struct FlatVertex {
+    uint64_t stop;
+    uint64_t waiting;
+    uint64_t arrive; // FLAT_NO_VERTEX, если вершины прибытия нет
+};
+
+struct FlatEdge {
+    uint32_t from;
+    uint32_t to;
+    double weight;
+    uint32_t type;
+    uint32_t index;
+    uint32_t span_count;
+    uint32_t reserved;
+};
+
+struct FlatRoute {
+    double weight;      // < 0, если пути нет
+    uint64_t prev_edge; // 0 - нет ребра, иначе EdgeId + 1
+};
+
+struct FlatShortcut {
+    uint32_t from;
+    uint32_t to;
+    double weight;
+    uint64_t first;
+    uint64_t second;
+};
+
+// файл базы, отображенный в память только для чтения
+class MappedFile {
+public:
+    explicit MappedFile(const std::string & path) {
+#ifdef TC_HAS_MMAP
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return;
+        }
+        struct stat st;
+        if (::fstat(fd, &st) == 0 && st.st_size > 0) {
+            void * data = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data != MAP_FAILED) {
+                data_ = static_cast<const char*>(data);
+                size_ = static_cast<size_t>(st.st_size);
+            }
+        }
+        ::close(fd);
+#else
+        std::ifstream input(path, std::ios::binary);
+        buffer_.assign(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+        data_ = buffer_.data();
+        size_ = buffer_.size();
+#endif
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    ~MappedFile() {
+#ifdef TC_HAS_MMAP
+        if (data_ != nullptr) {
+            ::munmap(const_cast<char*>(data_), size_);
+        }
+#endif
+    }
+
+    std::string_view Data() const {
+        return {data_, size_};
+    }
+
+private:
+    const char * data_ = nullptr;
+    size_t size_ = 0;
+#ifndef TC_HAS_MMAP
+    std::string buffer_;
+#endif
+};
+
+// секции отображенного файла с проверкой границ
+class FlatView {
+public:
+    FlatView(std::string_view file, const FlatHeader & header)
+        : file_(file)
+        , header_(header)
+    {}
+
+    template <typename T>
+    bool GetArray(FlatSectionId id, const T *& data, size_t & count) const {
+        const FlatSection & section = header_.sections[id];
+        if (section.offset > file_.size() || section.size > file_.size() - section.offset
+                || section.offset % alignof(T) != 0 || section.size % sizeof(T) != 0) {
+            return false;
+        }
+        data = reinterpret_cast<const T*>(file_.data() + section.offset);
+        count = section.size / sizeof(T);
+        return true;
+    }
+
+    bool GetBytes(FlatSectionId id, std::string_view & bytes) const {
+        const char * data = nullptr;
+        size_t count = 0;
+        if (!GetArray(id, data, count)) {
+            return false;
+        }
+        bytes = {data, count};
+        return true;
+    }
+
+private:
+    std::string_view file_;
+    const FlatHeader & header_;
+};
+
+// сборка секций при записи
+class FlatWriter {
+public:
+    template <typename T>
+    void Add(FlatSectionId id, const std::vector<T> & items) {
+        Add(id, items.data(), items.size() * sizeof(T));
+    }
+
+    void Add(FlatSectionId id, std::string_view bytes) {
+        Add(id, bytes.data(), bytes.size());
+    }
+
+    void Write(FlatHeader & header, std::ostream & output) const {
+        static const char padding[8] = {};
+        uint64_t offset = Align(sizeof(FlatHeader));
+        for (uint32_t id = 0; id < SECTION_COUNT; ++id) {
+            header.sections[id] = {offset, chunks_[id].second};
+            offset = Align(offset + chunks_[id].second);
+        }
+        output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        output.write(padding, Align(sizeof(FlatHeader)) - sizeof(FlatHeader));
+        for (uint32_t id = 0; id < SECTION_COUNT; ++id) {
+            const auto & [data, size] = chunks_[id];
+            output.write(static_cast<const char*>(data), size);
+            output.write(padding, Align(size) - size);
+        }
+    }
+
+private:
+    static uint64_t Align(uint64_t value) {
+        return (value + 7) & ~uint64_t{7};
+    }
+
+    void Add(FlatSectionId id, const void * data, size_t size) {
+        chunks_[id] = {data, size};
+    }
+
+    std::pair<const void*, size_t> chunks_[SECTION_COUNT] = {};
+};
+
+// имя в общей таблице строк
+std::pair<uint32_t, uint32_t> flatAddString(std::string & strings, std::string_view value) {
+    const auto offset = static_cast<uint32_t>(strings.size());
+    strings.append(value);
+    return {offset, static_cast<uint32_t>(value.size())};
+}
+
+bool flatGetString(std::string_view strings, uint32_t offset, uint32_t size, std::string_view & value) {
+    if (offset > strings.size() || size > strings.size() - offset) {
+        return false;
+    }
+    value = strings.substr(offset, size);
+    return true;
+}
+
+// расстояния в том виде, в каком их применяет FillDatabase: для каждой
+// остановки берется последний непустой список, неизвестные остановки пропускаются
+std::vector<FlatDistance> flatDistances(const domain::STOPS & stops,
+                                        const tcatalogue::TransportCatalogue & db) {
+    std::unordered_map<std::string_view, const domain::STOP*> last;
+    for (const domain::STOP & stop : stops) {
+        if (!stop.distances_.empty()) {
+            last[stop.stop_name_] = &stop;
+        }
+    }
+    std::vector<FlatDistance> result;
+    for (const domain::STOP & stop : stops) {
+        auto it = last.find(stop.stop_name_);
+        if (it == last.end() || it->second != &stop) {
+            continue;
+        }
+        const domain::Stop * stop_from = db.GetStop(stop.stop_name_);
+        for (const auto & [name, meters] : stop.distances_) {
+            if (const domain::Stop * stop_to = db.GetStop(name); stop_to != nullptr) {
+                result.push_back({static_cast<uint32_t>(stop_from->index),
+                                  static_cast<uint32_t>(stop_to->index),
+                                  static_cast<uint64_t>(meters)});
+            }
+        }
+    }
+    return result;
+}
+
+void flatRouteGraphSerialize(const RouteGraph::Snapshot & graph,
+                             std::vector<FlatVertex> & vertices,
+                             std::vector<FlatEdge> & edges,
+                             std::vector<FlatRoute> & routes,
+                             std::vector<uint32_t> & ranks,
+                             std::vector<FlatShortcut> & shortcuts) {
+    vertices.reserve(graph.vertices.size());
+    for (const auto & vertex : graph.vertices) {
+        vertices.push_back({vertex.stop_index, vertex.idx_waiting,
+                            vertex.idx_arrive == std::numeric_limits<graph::VertexId>::max()
+                                ? FLAT_NO_VERTEX : vertex.idx_arrive});
+    }
+    edges.reserve(graph.edges.size());
+    for (size_t i = 0; i < graph.edges.size(); ++i) {
+        const RouteGraph::Ed & edge = graph.edges[i];
+        const RouteGraph::Snapshot::EdgeInfo & info = graph.edge_infos[i];
+        edges.push_back({static_cast<uint32_t>(edge.from), static_cast<uint32_t>(edge.to), edge.weight,
+                         static_cast<uint32_t>(info.type), static_cast<uint32_t>(info.index),
+                         static_cast<uint32_t>(info.span_count), 0});
+    }
+    if (graph.routes_internal_data.has_value()) {
+        routes.reserve(graph.vertex_count * graph.vertex_count);
+        for (const auto & row : graph.routes_internal_data.value()) {
+            for (const auto & route : row) {
+                routes.push_back({route ? route->weight : -1.0,
+                                  route && route->prev_edge ? *route->prev_edge + 1 : 0});
+            }
+        }
+    }
+    if (graph.hierarchy.has_value()) {
+        const auto & hierarchy = graph.hierarchy.value();
+        ranks.assign(hierarchy.ranks.begin(), hierarchy.ranks.end());
+        shortcuts.reserve(hierarchy.shortcuts.size());
+        for (const auto & shortcut : hierarchy.shortcuts) {
+            shortcuts.push_back({static_cast<uint32_t>(shortcut.from), static_cast<uint32_t>(shortcut.to),
+                                 shortcut.weight, shortcut.first, shortcut.second});
+        }
+    }
+}
+
+// граф ссылается на stop_count остановок и bus_count маршрутов каталога
+bool flatRouteGraphDeserialize(const FlatView & view, const FlatHeader & header,
+                               size_t stop_count, size_t bus_count,
+                               RouteGraph::Snapshot & graph) {
+    const FlatVertex * vertices = nullptr;
+    const FlatEdge * edges = nullptr;
+    size_t vertex_count = 0;
+    size_t edge_count = 0;
+    if (!view.GetArray(SECTION_GRAPH_VERTICES, vertices, vertex_count)
+            || !view.GetArray(SECTION_GRAPH_EDGES, edges, edge_count)) {
+        return false;
+    }
+    graph.vertex_count = header.graph_vertex_count;
+    graph.vertices.clear();
+    graph.vertices.reserve(vertex_count);
+    for (size_t i = 0; i < vertex_count; ++i) {
+        const FlatVertex & vertex = vertices[i];
+        graph.vertices.push_back({vertex.stop, vertex.waiting,
+                                  vertex.arrive == FLAT_NO_VERTEX
+                                      ? std::numeric_limits<graph::VertexId>::max() : vertex.arrive});
+    }
+    graph.edges.clear();
+    graph.edges.reserve(edge_count);
+    graph.edge_infos.clear();
+    graph.edge_infos.reserve(edge_count);
+    for (size_t i = 0; i < edge_count; ++i) {
+        const FlatEdge & edge = edges[i];
+        if (edge.from >= graph.vertex_count || edge.to >= graph.vertex_count) {
+            return false;
+        }
+        graph.edges.push_back({edge.from, edge.to, edge.weight});
+        graph.edge_infos.push_back({static_cast<RouteGraph::EDGE_TYPE>(edge.type), edge.index, edge.span_count});
+    }
+
+    graph.routes_internal_data.reset();
+    if (header.flags & FLAG_ROUTER_DATA) {
+        const FlatRoute * routes = nullptr;
+        size_t route_count = 0;
+        if (!view.GetArray(SECTION_ROUTER_DATA, routes, route_count)
+                || route_count != graph.vertex_count * graph.vertex_count
+                || (graph.vertex_count != 0 && route_count / graph.vertex_count != graph.vertex_count)) {
+            return false;
+        }
+        using RouteInternalData = RouteGraph::ROUTER::RouteInternalData;
+        RouteGraph::ROUTER::RoutesInternalData routes_internal_data(
+            graph.vertex_count, std::vector<std::optional<RouteInternalData>>(graph.vertex_count));
+        for (auto & row : routes_internal_data) {
+            for (auto & route : row) {
+                if (routes->weight >= 0.0) {
+                    route = RouteInternalData{routes->weight, std::nullopt};
+                    if (routes->prev_edge != 0) {
+                        route->prev_edge = routes->prev_edge - 1;
+                    }
+                }
+                ++routes;
+            }
+        }
+        graph.routes_internal_data = std::move(routes_internal_data);
+    }
+
+    graph.hierarchy.reset();
+    if (header.flags & FLAG_HIERARCHY) {
+        const uint32_t * ranks = nullptr;
+        const FlatShortcut * shortcuts = nullptr;
+        size_t rank_count = 0;
+        size_t shortcut_count = 0;
+        if (!view.GetArray(SECTION_CH_RANKS, ranks, rank_count)
+                || !view.GetArray(SECTION_CH_SHORTCUTS, shortcuts, shortcut_count)) {
+            return false;
+        }
+        RouteGraph::CH_ROUTER::Hierarchy hierarchy;
+        hierarchy.ranks.assign(ranks, ranks + rank_count);
+        hierarchy.shortcuts.reserve(shortcut_count);
+        for (size_t i = 0; i < shortcut_count; ++i) {
+            const FlatShortcut & shortcut = shortcuts[i];
+            hierarchy.shortcuts.push_back({shortcut.from, shortcut.to, shortcut.weight,
+                                           shortcut.first, shortcut.second});
+        }
+        graph.hierarchy = std::move(hierarchy);
+    }
+    // номера вершин, ребер, остановок, маршрутов и сокращений
+    return graph.IsValid(stop_count, bus_count);
+}
+
+} // namespace
+
+bool Serialization::IsFlat(const Context & context) {
+    std::ifstream input_file(GetFilePath(context), std::ios::binary);
+    char magic[sizeof(FLAT_MAGIC)] = {};
+    return input_file.read(magic, sizeof(magic))
+        && std::memcmp(magic, FLAT_MAGIC, sizeof(magic)) == 0;
+}
+
+void Serialization::WriteFlat(const Context & context) {
+    // порядковые номера остановок и маршрутов назначает каталог, поэтому
+    // раскладку строим по заполненному каталогу
+    tcatalogue::TransportCatalogue db;
+    domain::FillDatabase(db, context.stops, context.busses);
+
+    std::string strings;
+    std::vector<FlatStop> stops;
+    stops.reserve(db.StopCount());
+    for (size_t i = 0; i < db.StopCount(); ++i) {
+        const domain::Stop * stop = db.GetStopByIndex(i);
+        const auto [name_offset, name_size] = flatAddString(strings, stop->name);
+        stops.push_back({name_offset, name_size, stop->coordinates.lat, stop->coordinates.lng});
+    }
+
+    std::vector<FlatBus> buses;
+    std::vector<uint32_t> bus_stops;
+    buses.reserve(db.BusCount());
+    for (size_t i = 0; i < db.BusCount(); ++i) {
+        const domain::Bus * bus = db.GetBusByIndex(i);
+        const auto [name_offset, name_size] = flatAddString(strings, bus->id);
+        buses.push_back({name_offset, name_size, static_cast<uint32_t>(bus_stops.size()),
+                         static_cast<uint32_t>(bus->stops.size()), bus->is_round_trip, 0});
+        for (const domain::Stop * stop : bus->stops) {
+            bus_stops.push_back(static_cast<uint32_t>(stop->index));
+        }
+    }
+
+    // показатели маршрутов посчитаны при заполнении каталога
+    std::vector<FlatBusStats> bus_stats;
+    bus_stats.reserve(db.BusCount());
+    for (const domain::BusStats & stats : db.GetAllBusStats()) {
+        bus_stats.push_back({stats.geo_length, stats.route_length, stats.stop_count, stats.unique_stop_count});
+    }
+
+    const std::vector<FlatDistance> distances = flatDistances(context.stops, db);
+    const std::string settings = WriteSettings(context);
+
+    FlatHeader header{};
+    std::memcpy(header.magic, FLAT_MAGIC, sizeof(FLAT_MAGIC));
+    header.version = FLAT_VERSION;
+    header.byte_order = FLAT_BYTE_ORDER;
+
+    FlatWriter writer;
+    writer.Add(SECTION_STRINGS, strings);
+    writer.Add(SECTION_STOPS, stops);
+    writer.Add(SECTION_BUSES, buses);
+    writer.Add(SECTION_BUS_STOPS, bus_stops);
+    writer.Add(SECTION_DISTANCES, distances);
+    writer.Add(SECTION_SETTINGS, settings);
+    header.flags |= FLAG_BUS_STATS;
+    writer.Add(SECTION_BUS_STATS, bus_stats);
+    if (context.rendered_map.has_value()) {
+        header.flags |= FLAG_RENDERED_MAP;
+        writer.Add(SECTION_RENDERED_MAP, context.rendered_map.value());
+    }
+
+    std::vector<FlatVertex> vertices;
+    std::vector<FlatEdge> edges;
+    std::vector<FlatRoute> routes;
+    std::vector<uint32_t> ranks;
+    std::vector<FlatShortcut> shortcuts;
+    if (context.route_graph.has_value()) {
+        const RouteGraph::Snapshot & graph = context.route_graph.value();
+        flatRouteGraphSerialize(graph, vertices, edges, routes, ranks, shortcuts);
+        header.flags |= FLAG_ROUTE_GRAPH;
+        header.graph_vertex_count = graph.vertex_count;
+        if (graph.routes_internal_data.has_value()) {
+            header.flags |= FLAG_ROUTER_DATA;
+        }
+        if (graph.hierarchy.has_value()) {
+            header.flags |= FLAG_HIERARCHY;
+        }
+        writer.Add(SECTION_GRAPH_VERTICES, vertices);
+        writer.Add(SECTION_GRAPH_EDGES, edges);
+        writer.Add(SECTION_ROUTER_DATA, routes);
+        writer.Add(SECTION_CH_RANKS, ranks);
+        writer.Add(SECTION_CH_SHORTCUTS, shortcuts);
+    }
+
+    std::ofstream output_file(GetFilePath(context), std::ios::binary);
+    writer.Write(header, output_file);
+}
+
+bool Serialization::ReadFlat(Context & context, tcatalogue::TransportCatalogue & db) {
+    const MappedFile file(GetFilePath(context));
+    const std::string_view data = file.Data();
+    // заголовок версии 1 короче на секции, добавленные позже
+    const size_t v1_header_size = sizeof(FlatHeader) - (SECTION_COUNT - FLAT_V1_SECTION_COUNT) * sizeof(FlatSection);
+    FlatHeader header{};
+    if (data.size() < v1_header_size) {
+        return false;
+    }
+    // секции по умолчанию пусты, поэтому заголовок копируется побайтно поверх них
+    std::memcpy(static_cast<void*>(&header), data.data(), v1_header_size);
+    if (std::memcmp(header.magic, FLAT_MAGIC, sizeof(FLAT_MAGIC)) != 0
+            || (header.version != 1 && header.version != FLAT_VERSION) || header.byte_order != FLAT_BYTE_ORDER) {
+        return false;
+    }
+    if (header.version == FLAT_VERSION) {
+        if (data.size() < sizeof(FlatHeader)) {
+            return false;
+        }
+        std::memcpy(static_cast<void*>(&header), data.data(), sizeof(FlatHeader));
+    }
+    const FlatView view(data, header);
+
+    std::string_view strings;
+    const FlatStop * stops = nullptr;
+    const FlatBus * buses = nullptr;
+    const uint32_t * bus_stops = nullptr;
+    const FlatDistance * distances = nullptr;
+    size_t stop_count = 0;
+    size_t bus_count = 0;
+    size_t bus_stop_count = 0;
+    size_t distance_count = 0;
+    if (!view.GetBytes(SECTION_STRINGS, strings)
+            || !view.GetArray(SECTION_STOPS, stops, stop_count)
+            || !view.GetArray(SECTION_BUSES, buses, bus_count)
+            || !view.GetArray(SECTION_BUS_STOPS, bus_stops, bus_stop_count)
+            || !view.GetArray(SECTION_DISTANCES, distances, distance_count)) {
+        return false;
+    }
+
+    context.stops.clear();
+    context.busses.clear();
+    for (size_t i = 0; i < stop_count; ++i) {
+        std::string_view name;
+        if (!flatGetString(strings, stops[i].name_offset, stops[i].name_size, name)) {
+            return false;
+        }
+        db.AddStop(std::string(name), {stops[i].lat, stops[i].lng});
+        if (db.StopCount() != i + 1) {
+            return false; // повторное имя остановки
+        }
+    }
+
+    std::vector<size_t> stop_indices;
+    for (size_t i = 0; i < bus_count; ++i) {
+        const FlatBus & bus = buses[i];
+        std::string_view name;
+        if (!flatGetString(strings, bus.name_offset, bus.name_size, name)
+                || bus.stops_begin > bus_stop_count || bus.stops_count > bus_stop_count - bus.stops_begin) {
+            return false;
+        }
+        stop_indices.assign(bus_stops + bus.stops_begin, bus_stops + bus.stops_begin + bus.stops_count);
+        for (size_t index : stop_indices) {
+            if (index >= stop_count) {
+                return false;
+            }
+        }
+        db.AddBus(std::string(name), stop_indices, bus.is_round_trip != 0);
+    }
+
+    for (size_t i = 0; i < distance_count; ++i) {
+        const FlatDistance & distance = distances[i];
+        if (distance.from >= stop_count || distance.to >= stop_count) {
+            return false;
+        }
+        db.SetDistanceBetween(db.GetStopByIndex(distance.from), db.GetStopByIndex(distance.to), distance.meters);
+    }
+
+    // показатели маршрутов задаются после расстояний, которые их сбрасывают
+    if (header.flags & FLAG_BUS_STATS) {
+        const FlatBusStats * bus_stats = nullptr;
+        size_t bus_stats_count = 0;
+        if (!view.GetArray(SECTION_BUS_STATS, bus_stats, bus_stats_count)) {
+            return false;
+        }
+        std::vector<domain::BusStats> stats;
+        stats.reserve(bus_stats_count);
+        for (size_t i = 0; i < bus_stats_count; ++i) {
+            stats.push_back({bus_stats[i].geo_length, bus_stats[i].route_length,
+                             bus_stats[i].stop_count, bus_stats[i].unique_stop_count});
+        }
+        if (!db.SetBusStats(std::move(stats))) {
+            return false;
+        }
+    } else {
+        db.ComputeBusStats();
+    }
+    db.ComputeStopBusNames();
+
+    std::string_view settings;
+    if (!view.GetBytes(SECTION_SETTINGS, settings) || !ReadSettings(settings, context)) {
+        return false;
+    }
+
+    context.rendered_map.reset();
+    if (header.flags & FLAG_RENDERED_MAP) {
+        std::string_view rendered_map;
+        if (!view.GetBytes(SECTION_RENDERED_MAP, rendered_map)) {
+            return false;
+        }
+        context.rendered_map = std::string(rendered_map);
+    }
+
+    context.route_graph.reset();
+    if (header.flags & FLAG_ROUTE_GRAPH) {
+        RouteGraph::Snapshot route_graph;
+        if (!flatRouteGraphDeserialize(view, header, db.StopCount(), db.BusCount(), route_graph)) {
+            return false;
+        }
+        context.route_graph = std::move(route_graph);
+    }
+    return true;
+}
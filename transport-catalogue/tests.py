@@ -74,3 +74,186 @@ for filename in files:
 	for resp in out_json:
 		if resp['request_id'] in cur_exp and 'total_time' in resp and resp['total_time'] != cur_exp[resp['request_id']]:
 			print(" ! id=%d actual=%f expected=%f" % (resp['request_id'], resp['total_time'], cur_exp[resp['request_id']]))
+
+def MAKE_BASE(make_base, base_format):
+	binary = os.getcwd() + '/build/transport_catalogue'
+	make_base_json = json.load(open(os.getcwd() + '/tests/' + make_base))
+	make_base_json['serialization_settings']['format'] = base_format
+	process = subprocess.Popen([binary, 'make_base'], stdin=subprocess.PIPE)
+	process.communicate(json.dumps(make_base_json).encode('utf-8'))
+	if process.returncode != 0:
+		print(" ! make_base exit code %d" % process.returncode)
+		return False
+	return True
+
+# база make_base/process_requests в каждом формате должна отвечать одинаково
+def EXEC_BASE(make_base, process_requests, base_format):
+	binary = os.getcwd() + '/build/transport_catalogue'
+	if not MAKE_BASE(make_base, base_format):
+		return []
+	f = open(os.getcwd() + '/tests/' + process_requests)
+	process = subprocess.Popen([binary, 'process_requests'], stdout=subprocess.PIPE, stdin=f)
+	output, error = process.communicate()
+	return json.loads(output.decode('utf-8'))
+
+bases = [
+	# повторное имя остановки не сдвигает номера следующих остановок
+	("dup_stop_make_base.json", "dup_stop_process_requests.json", "dup_stop_answer.json"),
+	# маршруты из одной остановки, в том числе после отброса неизвестной, не роняют make_base
+	("short_bus_make_base.json", "short_bus_process_requests.json", "short_bus_answer.json"),
+]
+
+for make_base, process_requests, answer in bases:
+	expected = json.load(open(os.getcwd() + '/tests/' + answer))
+	for base_format in ["protobuf", "flat"]:
+		print("%s (%s)" % (make_base, base_format))
+		out_json = EXEC_BASE(make_base, process_requests, base_format)
+		if len(out_json) != len(expected):
+			print(" ! %d responses, expected %d" % (len(out_json), len(expected)))
+		for resp, exp_resp in zip(out_json, expected):
+			if resp != exp_resp:
+				print(" ! id=%d actual=%s expected=%s" % (exp_resp['request_id'], json.dumps(resp), json.dumps(exp_resp)))
+
+# путь Route из откликов: ожидание на остановке, затем поездка на span_count
+# остановок одного маршрута. при равных по времени путях допустим любой,
+# поэтому items проверяются по маршрутам и расстояниям базы, а не побуквенно
+def CHECK_ROUTE(base_requests, routing_settings, req, resp):
+	speed = routing_settings['bus_velocity'] * 1000.0 / 60.0
+	distances = {}
+	buses = {}
+	for base_req in base_requests:
+		if base_req['type'] == 'Stop':
+			for to, meters in base_req.get('road_distances', {}).items():
+				distances[(base_req['name'], to)] = meters
+		elif base_req['type'] == 'Bus':
+			stops = base_req['stops']
+			buses[base_req['name']] = stops if base_req['is_roundtrip'] else stops + stops[-2::-1]
+	def distance(a, b):
+		return distances.get((a, b), distances.get((b, a), 0))
+	at = req['from']
+	total = 0.0
+	for item in resp['items']:
+		total += item['time']
+		if item['type'] == 'Wait':
+			if item['stop_name'] != at or abs(item['time'] - routing_settings['bus_wait_time']) > 1e-9:
+				return False
+			continue
+		stops = buses.get(item['bus'], [])
+		span_count = item['span_count']
+		found = None
+		for i in range(len(stops) - span_count):
+			if stops[i] != at:
+				continue
+			time = sum(distance(stops[j], stops[j + 1]) for j in range(i, i + span_count)) / speed
+			if abs(time - item['time']) < 1e-5 * max(1, time):
+				found = stops[i + span_count]
+				break
+		if found is None:
+			return False
+		at = found
+	return at == req['to'] and abs(total - resp['total_time']) < 1e-4 * max(1, total)
+
+# s12_final_opentest_N.json: base_requests и stat_requests в одном файле.
+# routing дополняет routing_settings файла
+def EXEC_OPENTEST(filename, routing, base_format):
+	binary = os.getcwd() + '/build/transport_catalogue'
+	doc = json.load(open(os.getcwd() + '/tests/' + filename))
+	settings = {'file': 'opentest.db', 'format': base_format}
+	make_base_json = {key: value for key, value in doc.items() if key != 'stat_requests'}
+	make_base_json['serialization_settings'] = settings
+	make_base_json['routing_settings'] = dict(doc['routing_settings'], **routing)
+	process = subprocess.Popen([binary, 'make_base'], stdin=subprocess.PIPE)
+	process.communicate(json.dumps(make_base_json).encode('utf-8'))
+	if process.returncode != 0:
+		print(" ! make_base exit code %d" % process.returncode)
+		return doc, []
+	process_requests_json = {'serialization_settings': settings, 'stat_requests': doc['stat_requests']}
+	process = subprocess.Popen([binary, 'process_requests'], stdin=subprocess.PIPE, stdout=subprocess.PIPE)
+	output, error = process.communicate(json.dumps(process_requests_json).encode('utf-8'))
+	return doc, json.loads(output.decode('utf-8'))
+
+opentests = [
+	("s12_final_opentest_1.json", "s12_final_opentest_1_answer.json"),
+	("s12_final_opentest_2.json", "s12_final_opentest_2_answer.json"),
+	("s12_final_opentest_3.json", "s12_final_opentest_3_answer.json"),
+]
+
+# маршрутизаторы и модели графа, выбираемые в routing_settings. каждое
+# сочетание проверяется на базе в обоих форматах: граф и таблицы
+# маршрутизатора читаются из базы
+opentest_routings = []
+for router in ['floyd_warshall', 'dijkstra', 'contraction_hierarchies']:
+	for graph_model in ['all_spans', 'on_board']:
+		opentest_routings.append({'router': router, 'graph_model': graph_model})
+
+# в модели on_board вершин в разы больше, и таблица Floyd–Warshall V×V для
+# s12_final_opentest_3 не строится и за девять минут
+def OPENTEST_TOO_SLOW(filename, routing):
+	return routing == {'router': 'floyd_warshall', 'graph_model': 'on_board'} \
+		and filename == "s12_final_opentest_3.json"
+
+opentest_runs = []
+for routing in opentest_routings:
+	for base_format in ["protobuf", "flat"]:
+		for filename, answer in opentests:
+			if not OPENTEST_TOO_SLOW(filename, routing):
+				opentest_runs.append((filename, answer, routing, base_format))
+
+for filename, answer, routing, base_format in opentest_runs:
+	print("%s (%s, %s)" % (filename, ", ".join(routing.values()), base_format))
+	doc, out_json = EXEC_OPENTEST(filename, routing, base_format)
+	requests = {req['id']: req for req in doc['stat_requests']}
+	expected = {resp['request_id']: resp for resp in json.load(open(os.getcwd() + '/tests/' + answer))}
+	for resp in out_json:
+		req = requests[resp['request_id']]
+		exp_resp = expected[resp['request_id']]
+		if req['type'] != 'Route':
+			continue
+		if ('items' in resp) != ('items' in exp_resp):
+			print(" ! id=%d actual=%s expected=%s" % (resp['request_id'], json.dumps(resp), json.dumps(exp_resp)))
+		elif 'items' not in resp:
+			continue
+		elif abs(resp['total_time'] - exp_resp['total_time']) > 1e-4 * max(1, exp_resp['total_time']):
+			print(" ! id=%d actual=%f expected=%f" % (resp['request_id'], resp['total_time'], exp_resp['total_time']))
+		elif not CHECK_ROUTE(doc['base_requests'], doc['routing_settings'], req, resp):
+			print(" ! id=%d invalid items %s" % (resp['request_id'], json.dumps(resp['items'])))
+
+# режим serve: пакеты в одну строку и пакеты с длиной в байтах. на пакет
+# короче заявленной длины или слишком длинный - error_message, и поток закрывается
+def EXEC_SERVE(batches):
+	binary = os.getcwd() + '/build/transport_catalogue'
+	process = subprocess.Popen([binary, 'serve'], stdin=subprocess.PIPE, stdout=subprocess.PIPE)
+	output, error = process.communicate(batches.encode('utf-8'))
+	output = output.decode('utf-8')
+	responses = []
+	while output:
+		line, _, output = output.partition('\n')
+		if line.isdigit():
+			responses.append(json.loads(output[:int(line)]))
+			output = output[int(line):]
+		elif line.strip():
+			responses.append(json.loads(line))
+	return process.returncode, responses
+
+def SIZED(text):
+	return '%d\n%s' % (len(text.encode('utf-8')), text)
+
+print("serve")
+if MAKE_BASE("dup_stop_make_base.json", "protobuf"):
+	settings = json.load(open(os.getcwd() + '/tests/dup_stop_process_requests.json'))
+	expected = json.load(open(os.getcwd() + '/tests/dup_stop_answer.json'))
+	settings_batch = json.dumps(settings)
+	stat_batch = json.dumps({'stat_requests': settings['stat_requests']})
+	cases = [
+		("lines", settings_batch + '\n' + stat_batch + '\n', [expected, expected]),
+		("sized", SIZED(settings_batch) + SIZED(stat_batch), [expected, expected]),
+		("invalid", settings_batch + '\n{"stat_requests": \n', [expected, {'error_message': 'invalid batch'}]),
+		("truncated", settings_batch + '\n' + stat_batch + '\n1000\n' + stat_batch,
+			[expected, expected, {'error_message': 'batch is truncated'}]),
+		("too large", settings_batch + '\n99999999999999999999\n' + stat_batch + '\n',
+			[expected, {'error_message': 'batch is too large'}]),
+	]
+	for name, batches, expected_responses in cases:
+		returncode, responses = EXEC_SERVE(batches)
+		if returncode != 0 or responses != expected_responses:
+			print(" ! %s: exit code %d, responses %s" % (name, returncode, json.dumps(responses)))
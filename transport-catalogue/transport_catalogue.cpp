@@ -1,6 +1,7 @@
 #include "transport_catalogue.h"
-#include <functional>
+#include <algorithm>
 #include <cassert>
+#include <limits>
 #include "domain.h"
 
 using namespace std;
@@ -8,50 +9,95 @@ using namespace domain;
 
 namespace tcatalogue {
 
-TransportCatalogue::~TransportCatalogue() {
-    for (auto & [_, pbus] : buses_) {
-        delete pbus;
-    }
-    buses_.clear();
-    for (auto & [_, pstop] : stops_) {
-        delete pstop;
-    }
-    stops_.clear();
+TransportCatalogue::~TransportCatalogue() = default;
+
+void TransportCatalogue::Reserve(size_t stop_count, size_t bus_count, size_t distance_count) {
+    stop_storage_.Reserve(stop_count);
+    bus_storage_.Reserve(bus_count);
+    stops_.reserve(stop_count);
+    stops_by_index_.reserve(stop_count);
+    stop_to_buses_.reserve(stop_count);
+    buses_.reserve(bus_count);
+    buses_by_index_.reserve(bus_count);
+    distance_offsets_.reserve(stop_count + 1);
+    distances_.reserve(distance_count);
 }
 
-void TransportCatalogue::AddStop(std::string name, geo::Coordinates coordinates) {
+Stop* TransportCatalogue::AddStop(std::string name, geo::Coordinates coordinates) {
 	auto it = stops_.find(name);
 	if (it == stops_.end()) {
-        Stop* current_stop = new Stop{ move(name), move(coordinates) };
+        assert(stops_by_index_.size() < std::numeric_limits<uint32_t>::max());
+        Stop* current_stop = &stop_storage_.Emplace(names_.Store(name), move(coordinates),
+                                                    static_cast<uint32_t>(stops_by_index_.size()));
         stops_[current_stop->name] = current_stop;
-        stop_to_buses_[current_stop->name] = {};
+        stops_by_index_.push_back(current_stop);
+        stop_to_buses_.emplace_back();
+        stop_bus_name_offsets_.clear();
+        return current_stop;
 	} else {
 //        LOG() << "update coords for stop '" << name << "'." << std::endl;
         it->second->coordinates = move(coordinates);
+        bus_stats_.clear();
+        return it->second;
 	}
 }
 
-void TransportCatalogue::AddBus(BusId id, const StopsList & stops, bool is_round_trip) {
+Bus* TransportCatalogue::EmplaceBus(BusId id, bool is_round_trip) {
+    bus_stats_.clear();
+    stop_bus_name_offsets_.clear();
     Bus* current_bus = nullptr;
     auto it = buses_.find(id);
     if (it == buses_.end()) {
-        current_bus = new Bus{ std::move(id), is_round_trip, {} };
+        assert(buses_by_index_.size() < std::numeric_limits<uint32_t>::max());
+        current_bus = &bus_storage_.Emplace(names_.Store(id), is_round_trip, std::vector<Stop*>{},
+                                            static_cast<uint32_t>(buses_by_index_.size()));
         buses_[current_bus->id] = current_bus;
-        bus_ids_.insert(current_bus->id);
+        buses_by_index_.push_back(current_bus);
     } else {
         current_bus = it->second;
         assert(current_bus);
         current_bus->is_round_trip = is_round_trip;
+        // маршрут задан заново, убираем его со старых остановок
+        for (const Stop* stop : current_bus->stops) {
+            auto & stop_buses = stop_to_buses_[stop->index];
+            stop_buses.erase(std::remove(stop_buses.begin(), stop_buses.end(), current_bus), stop_buses.end());
+        }
     }
-    // build stops list
     current_bus->stops.clear();
+    return current_bus;
+}
+
+// маршрут добавляется одним вызовом, поэтому его повторная остановка
+// уже стоит последней в списке маршрутов этой остановки
+void TransportCatalogue::LinkStopBus(const Stop* stop, Bus* bus) {
+    auto & stop_buses = stop_to_buses_[stop->index];
+    if (stop_buses.empty() || stop_buses.back() != bus) {
+        stop_buses.push_back(bus);
+    }
+}
+
+void TransportCatalogue::AddBus(BusId id, const std::vector<size_t> & stop_indices, bool is_round_trip) {
+    Bus* current_bus = EmplaceBus(std::move(id), is_round_trip);
+    current_bus->stops.reserve(stop_indices.size());
+    for (size_t index : stop_indices) {
+        assert(index < stops_by_index_.size());
+        Stop* current_stop = stops_by_index_[index];
+        current_bus->stops.push_back(current_stop);
+        LinkStopBus(current_stop, current_bus);
+    }
+}
+
+void TransportCatalogue::AddBus(BusId id, const StopsList & stops, bool is_round_trip) {
+    Bus* current_bus = EmplaceBus(std::move(id), is_round_trip);
+    // build stops list
     for (auto & stop_name : stops) {
-        Stop* current_stop = stops_[stop_name];
-        if (current_stop == nullptr) {
+        auto stop_it = stops_.find(stop_name);
+        if (stop_it == stops_.end()) {
 //            WARN() << "bus" << id << " stop '" << stop_name << "' not found." << std::endl;
         } else {
+            Stop* current_stop = stop_it->second;
             current_bus->stops.push_back(current_stop);
-            stop_to_buses_[stop_name].insert(current_bus);
+            LinkStopBus(current_stop, current_bus);
         }
     }
 }
@@ -82,57 +128,147 @@ Stop* TransportCatalogue::GetStop(const std::string & stop_name) const {
     return (it->second);
 }
 
+const Stop* TransportCatalogue::GetStopByIndex(size_t index) const {
+    return (index < stops_by_index_.size() ? stops_by_index_[index] : nullptr);
+}
+
+const Bus* TransportCatalogue::GetBusByIndex(size_t index) const {
+    return (index < buses_by_index_.size() ? buses_by_index_[index] : nullptr);
+}
+
 StopBusesOpt TransportCatalogue::GetStopBuses(std::string_view stop_name) const {
-    auto it = stop_to_buses_.find(stop_name);
-    if (it == stop_to_buses_.end()) {
+    auto it = stops_.find(stop_name);
+    if (it == stops_.end()) {
         // WARN() << __FUNCTION__ << "stop '" << stop_name << "' not found." << std::endl;
         return std::nullopt;
     }
-    return StopBusesOpt(it->second);
+    return StopBusesOpt(stop_to_buses_[it->second->index]);
 }
 
+void TransportCatalogue::ComputeStopBusNames() {
+    size_t total = 0;
+    for (const auto & stop_buses : stop_to_buses_) {
+        total += stop_buses.size();
+    }
+    assert(total <= std::numeric_limits<uint32_t>::max());
+    stop_bus_names_.clear();
+    stop_bus_names_.reserve(total);
+    stop_bus_name_offsets_.clear();
+    stop_bus_name_offsets_.reserve(stop_to_buses_.size() + 1);
+    stop_bus_name_offsets_.push_back(0);
+    for (const auto & stop_buses : stop_to_buses_) {
+        const size_t first = stop_bus_names_.size();
+        for (const Bus* bus : stop_buses) {
+            stop_bus_names_.push_back(bus->id);
+        }
+        std::sort(stop_bus_names_.begin() + first, stop_bus_names_.end());
+        stop_bus_name_offsets_.push_back(static_cast<uint32_t>(stop_bus_names_.size()));
+    }
+}
+
+std::optional<StopBusNames> TransportCatalogue::GetStopBusNames(std::string_view stop_name) const {
+    auto it = stops_.find(stop_name);
+    if (it == stops_.end()) {
+        return std::nullopt;
+    }
+    const uint32_t index = it->second->index;
+    assert(index + 1 < stop_bus_name_offsets_.size());
+    const std::string_view* names = stop_bus_names_.data();
+    return StopBusNames(names + stop_bus_name_offsets_[index], names + stop_bus_name_offsets_[index + 1]);
+}
+
+// соседи добавляются в конец, если расстояния задаются по порядку остановок
+// отправления, как это делают загрузчики базы. расстояние от остановки с
+// меньшим номером сдвигает соседей всех следующих остановок.
 void TransportCatalogue::SetDistanceBetween(const Stop* stopA, const Stop* stopB, size_t value) {
     assert(stopA);
     assert(stopB);
-    auto p = std::make_pair(stopA, stopB);
-    distance_between_stops_[p] = value;
+    assert(value <= std::numeric_limits<uint32_t>::max());
+    bus_stats_.clear();
+    const uint32_t from = stopA->index;
+    if (from + 1 >= distance_offsets_.size()) {
+        const uint32_t end = distance_offsets_.back();
+        distance_offsets_.resize(from + 2, end);
+    }
+    const auto first = distances_.begin() + distance_offsets_[from];
+    const auto last = distances_.begin() + distance_offsets_[from + 1];
+    auto it = std::lower_bound(first, last, stopB->index,
+                               [](const DistanceTo & distance, uint32_t index) { return distance.to < index; });
+    if (it != last && it->to == stopB->index) {
+        it->meters = static_cast<uint32_t>(value);
+        return;
+    }
+    assert(distances_.size() < std::numeric_limits<uint32_t>::max());
+    distances_.insert(it, {stopB->index, static_cast<uint32_t>(value)});
+    for (size_t index = from + 1; index < distance_offsets_.size(); ++index) {
+        ++distance_offsets_[index];
+    }
 }
 
-size_t TransportCatalogue::GetDistanceBetween(const Stop* stopA, const Stop* stopB) const {
-    assert(stopA);
-    assert(stopB);
-    auto p = std::make_pair(stopA, stopB);
-    auto it = distance_between_stops_.find(p);
-    if (it == distance_between_stops_.end()) {
-        std::swap(p.first, p.second);
-        it = distance_between_stops_.find(p);
-        if (it == distance_between_stops_.end()) {
-            // WARN() << __FUNCTION__ << "pair of '" << stopA->name << "' and '"
-            //                                       << stopB->name << "' not found."
-            //                                       << std::endl;
-            return 0;
+// географическая и фактическая длина маршрута и число его остановок
+BusStats TransportCatalogue::CalculateBusStats(const Bus & bus) const {
+    BusStats stats;
+    const auto & v = bus.stops;
+    if (v.empty()) {
+        return stats;
+    }
+    for (size_t i = 0; i + 1 < v.size(); ++i) {
+        stats.geo_length += geo::ComputeDistance(v[i]->coordinates, v[i+1]->coordinates);
+        stats.route_length += GetDistanceBetween(v[i], v[i+1]);
+    }
+    if (bus.is_round_trip == false) {
+        stats.geo_length *= 2;
+        for (size_t i = v.size()-1; i > 0; --i) {
+            stats.route_length += GetDistanceBetween(v[i], v[i-1]);
         }
     }
-    return it->second;
+    stats.stop_count = static_cast<uint32_t>(bus.is_round_trip ? v.size() : v.size() * 2 - 1);
+    stats.unique_stop_count = static_cast<uint32_t>(UniqueStopsCount(bus));
+    return stats;
+}
+
+void TransportCatalogue::ComputeBusStats() {
+    std::vector<BusStats> stats;
+    stats.reserve(buses_by_index_.size());
+    for (const Bus* bus : buses_by_index_) {
+        stats.push_back(CalculateBusStats(*bus));
+    }
+    bus_stats_ = std::move(stats);
+}
+
+bool TransportCatalogue::SetBusStats(std::vector<BusStats> stats) {
+    if (stats.size() != buses_by_index_.size()) {
+        return false;
+    }
+    bus_stats_ = std::move(stats);
+    return true;
+}
+
+const std::vector<BusStats>& TransportCatalogue::GetAllBusStats() const {
+    return bus_stats_;
 }
 
-std::size_t TransportCatalogue::DistanceBetweenHash::operator()(const DistanceBetweenKey & p) const noexcept {
-    auto hash_function = std::hash<const void*>{};
-    std::size_t h1 = hash_function(p.first);
-    std::size_t h2 = hash_function(p.second);;
-    return h2 * 37 + h1 ;
+BusStats TransportCatalogue::GetBusStats(const Bus & bus) const {
+    if (bus.index < bus_stats_.size()) {
+        return bus_stats_[bus.index];
+    }
+    return CalculateBusStats(bus);
 }
 
-std::unordered_set<std::string_view>::const_iterator TransportCatalogue::begin() const {
-    return bus_ids_.begin();
+std::vector<Bus*>::const_iterator TransportCatalogue::begin() const {
+    return buses_by_index_.begin();
 }
 
-std::unordered_set<std::string_view>::const_iterator TransportCatalogue::end() const {
-    return bus_ids_.end();
+std::vector<Bus*>::const_iterator TransportCatalogue::end() const {
+    return buses_by_index_.end();
 }
 
 size_t TransportCatalogue::StopCount() const {
-    return stops_.size();
+    return stops_by_index_.size();
+}
+
+size_t TransportCatalogue::BusCount() const {
+    return buses_by_index_.size();
 }
 
 } // namespace tcatalogue
@@ -1,13 +1,16 @@
 #pragma once
 
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
 #include <unordered_map>
 #include <string>
 #include <vector>
 #include <list>
 #include <ostream>
-#include <unordered_set>
 #include <optional>
 
+#include "arena.h"
 #include "geo.h"
 #include "domain.h"
 
@@ -24,35 +27,126 @@ public:
     TransportCatalogue(TransportCatalogue &&) = delete;
     TransportCatalogue& operator=(TransportCatalogue &&) = delete;
 
-    void AddStop(std::string name, geo::Coordinates coordinates);
+    // резервирует место под известное заранее число объектов, например при загрузке базы
+    void Reserve(size_t stop_count, size_t bus_count, size_t distance_count);
+
+    // остановкам и маршрутам при добавлении назначаются плотные номера 0, 1, 2...
+    // по имени объект ищется один раз на входе запроса, а внутренние
+    // индексы каталога и графа маршрутов - массивы по этим номерам
+
+    // возвращает добавленную остановку или уже имеющуюся с тем же именем
+    domain::Stop* AddStop(std::string name, geo::Coordinates coordinates);
     void AddBus(domain::BusId id, const domain::StopsList & stops, bool is_ring_root);
+    // маршрут по порядковым номерам уже добавленных остановок, без поиска по имени
+    void AddBus(domain::BusId id, const std::vector<size_t> & stop_indices, bool is_round_trip);
 
     const domain::Bus& GetBus(std::string_view id) const;
     const domain::Bus* GetBusPtr(std::string_view id) const;
 
     size_t StopCount() const;
+    size_t BusCount() const;
 
     domain::Stop* GetStop(const std::string & stop_name) const;
 
+    // доступ по порядковому номеру, назначенному при добавлении
+    const domain::Stop* GetStopByIndex(size_t index) const;
+    const domain::Bus* GetBusByIndex(size_t index) const;
+
     domain::StopBusesOpt GetStopBuses(std::string_view stop_name) const;
 
+    // имена маршрутов каждой остановки сортируются один раз, когда каталог
+    // заполнен. новые остановки и маршруты их сбрасывают, до следующего
+    // вызова ComputeStopBusNames имена запрашивать нельзя
+    void ComputeStopBusNames();
+    std::optional<domain::StopBusNames> GetStopBusNames(std::string_view stop_name) const;
+
     void SetDistanceBetween(const domain::Stop* stopA, const domain::Stop* stopB, size_t value);
     size_t GetDistanceBetween(const domain::Stop* stopA, const domain::Stop* stopB) const;
 
-    std::unordered_set<std::string_view>::const_iterator begin() const;
-    std::unordered_set<std::string_view>::const_iterator end() const;
+    // показатели маршрутов считаются один раз, когда каталог заполнен, или
+    // берутся из базы. любое изменение маршрутов, координат или расстояний их сбрасывает
+    void ComputeBusStats();
+    // показатели по порядковым номерам маршрутов. false, если их число не совпадает с числом маршрутов
+    bool SetBusStats(std::vector<domain::BusStats> stats);
+    // пусто, если показатели не посчитаны
+    const std::vector<domain::BusStats>& GetAllBusStats() const;
+    // без посчитанных показателей считает их для одного маршрута
+    domain::BusStats GetBusStats(const domain::Bus & bus) const;
+
+    // маршруты в порядке их номеров
+    std::vector<domain::Bus*>::const_iterator begin() const;
+    std::vector<domain::Bus*>::const_iterator end() const;
 
 private:
-    std::unordered_set<std::string_view> bus_ids_;
+    domain::Bus* EmplaceBus(domain::BusId id, bool is_round_trip);
+    void LinkStopBus(const domain::Stop* stop, domain::Bus* bus);
+    domain::BusStats CalculateBusStats(const domain::Bus & bus) const;
+
+    // остановки, маршруты и их имена, на которые ссылаются остальные поля
+    ChunkedArena<domain::Stop> stop_storage_;
+    ChunkedArena<domain::Bus> bus_storage_;
+    StringArena names_;
+
+    // поиск по имени, только на входе запросов
     std::unordered_map<std::string_view, domain::Stop*> stops_;
     std::unordered_map<std::string_view, domain::Bus*> buses_;
-    std::unordered_map<std::string_view, std::unordered_set<domain::Bus*>> stop_to_buses_;
 
-    using DistanceBetweenKey = std::pair<const domain::Stop*, const domain::Stop*>;
-    struct DistanceBetweenHash {
-        std::size_t operator()(const DistanceBetweenKey & p) const noexcept;
+    // дальше все по номеру остановки или маршрута
+    std::vector<domain::Stop*> stops_by_index_;
+    std::vector<domain::Bus*> buses_by_index_;
+    std::vector<std::vector<domain::Bus*>> stop_to_buses_; // маршруты без повторов
+    std::vector<domain::BusStats> bus_stats_; // по номеру маршрута, пусто - не посчитаны
+    // имена маршрутов остановки from по алфавиту лежат в
+    // stop_bus_names_[stop_bus_name_offsets_[from], stop_bus_name_offsets_[from + 1])
+    std::vector<uint32_t> stop_bus_name_offsets_;
+    std::vector<std::string_view> stop_bus_names_;
+
+    struct DistanceTo {
+        uint32_t to;     // номер остановки назначения
+        uint32_t meters;
     };
-    std::unordered_map<DistanceBetweenKey, size_t, DistanceBetweenHash> distance_between_stops_;
+    // расстояния в формате CSR: соседи остановки from по возрастанию номера лежат
+    // в distances_[distance_offsets_[from], distance_offsets_[from + 1]).
+    // смещения заканчиваются на последней остановке, у которой есть соседи
+    std::vector<uint32_t> distance_offsets_ = std::vector<uint32_t>(1, 0);
+    std::vector<DistanceTo> distances_;
+    static constexpr size_t LINEAR_SEARCH_LIMIT = 16; // до скольких соседей поиск идет подряд
+
+    const DistanceTo* FindDistance(uint32_t from, uint32_t to) const;
 };
 
+// расстояние запрашивается во внутренних циклах расчета длины маршрутов и
+// построения графа, поэтому поиск встраивается в место вызова
+inline const TransportCatalogue::DistanceTo* TransportCatalogue::FindDistance(uint32_t from, uint32_t to) const {
+    if (from + 1 >= distance_offsets_.size()) {
+        return nullptr;
+    }
+    const DistanceTo* first = distances_.data() + distance_offsets_[from];
+    const DistanceTo* last = distances_.data() + distance_offsets_[from + 1];
+    if (static_cast<size_t>(last - first) <= LINEAR_SEARCH_LIMIT) {
+        // у большинства остановок несколько соседей, их быстрее просмотреть
+        // все подряд без ветвлений двоичного поиска
+        for (const DistanceTo* distance = first; distance != last; ++distance) {
+            if (distance->to == to) {
+                return distance;
+            }
+        }
+        return nullptr;
+    }
+    const DistanceTo* it = std::lower_bound(first, last, to,
+                               [](const DistanceTo & distance, uint32_t index) { return distance.to < index; });
+    return (it != last && it->to == to) ? it : nullptr;
+}
+
+// расстояние от A до B, а если оно не задано - от B до A
+inline size_t TransportCatalogue::GetDistanceBetween(const domain::Stop* stopA, const domain::Stop* stopB) const {
+    assert(stopA);
+    assert(stopB);
+    const DistanceTo* distance = FindDistance(stopA->index, stopB->index);
+    if (distance == nullptr) {
+        distance = FindDistance(stopB->index, stopA->index);
+    }
+    return (distance != nullptr) ? distance->meters : 0;
+}
+
 } // namespace tcatalogue
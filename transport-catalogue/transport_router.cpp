@@ -1,6 +1,12 @@
 #include "transport_router.h"
 #include "transport_catalogue.h"
-//#include "log_duration.h"
+#include "metrics.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <exception>
+#include <thread>
 
 using namespace domain;
 
@@ -11,25 +17,23 @@ RouteGraph::RouteGraph(tcatalogue::TransportCatalogue & db, const domain::Routin
     , graph_(db.StopCount() * 2)
 {}
 
-RouteGraph::~RouteGraph() {
-    for (auto [pStop, pCtx]: ctx_by_stop_) {
-        delete pCtx; // !!! our class owns only context
-    }
-}
+RouteGraph::~RouteGraph() = default;
 
 // получаем информацию о пути из графа и возвращаем его в переменную ri,
 // если есть таковой. в случае ошибочных ситуаций функция возвращает ложь.
-bool RouteGraph::Build(const std::string & from, const std::string & to, ROUTER::RouteInfo & ri) {
+bool RouteGraph::Build(const std::string & from, const std::string & to, ROUTER::RouteInfo & ri) const {
+    return Build(db_.GetStop(from), db_.GetStop(to), ri);
+}
+
+bool RouteGraph::Build(const Stop * stop_from, const Stop * stop_to, ROUTER::RouteInfo & ri) const {
     assert(isPrepared());
-    Stop * stop_from  = db_.GetStop( from );
-    Stop * stop_to    = db_.GetStop( to );
     if (stop_from && stop_to) {
-        VertexContext * ctx_from = ctx_by_stop_[ stop_from ];
-        VertexContext * ctx_to   = ctx_by_stop_[ stop_to ];
-        if (ctx_from && ctx_to) {
-            graph::VertexId idx_from = ctx_from->idx_waiting_;
-            graph::VertexId idx_to   = ctx_to->idx_waiting_;
-            std::optional<ROUTER::RouteInfo> opt_route_info = ptr_router_->BuildRoute(idx_from, idx_to);
+        const VertexContext & ctx_from = ctx_by_stop_[stop_from->index];
+        const VertexContext & ctx_to   = ctx_by_stop_[stop_to->index];
+        if (ctx_from.InGraph() && ctx_to.InGraph()) {
+            graph::VertexId idx_from = ctx_from.idx_waiting_;
+            graph::VertexId idx_to   = ctx_to.idx_waiting_;
+            std::optional<ROUTER::RouteInfo> opt_route_info = BuildRoute(idx_from, idx_to);
             if (opt_route_info.has_value()) {
                 ri = std::move(opt_route_info.value());
                 return true;
@@ -39,13 +43,68 @@ bool RouteGraph::Build(const std::string & from, const std::string & to, ROUTER:
     return false;
 }
 
+std::vector<std::optional<RouteGraph::ROUTER::RouteInfo>>
+RouteGraph::BuildFrom(const Stop * stop_from, const std::vector<const Stop*> & stops_to) const {
+    assert(isPrepared());
+    std::vector<std::optional<ROUTER::RouteInfo>> result(stops_to.size());
+    if (stop_from == nullptr || !ctx_by_stop_[stop_from->index].InGraph()) {
+        return result;
+    }
+    const graph::VertexId idx_from = ctx_by_stop_[stop_from->index].idx_waiting_;
+    // остановки вне графа недостижимы и в поиск не передаются
+    std::vector<graph::VertexId> targets;
+    std::vector<size_t> positions;
+    targets.reserve(stops_to.size());
+    positions.reserve(stops_to.size());
+    for (size_t i = 0; i < stops_to.size(); ++i) {
+        if (stops_to[i] != nullptr && ctx_by_stop_[stops_to[i]->index].InGraph()) {
+            targets.push_back(ctx_by_stop_[stops_to[i]->index].idx_waiting_);
+            positions.push_back(i);
+        }
+    }
+    if (HasOneToMany()) {
+        std::vector<std::optional<ROUTER::RouteInfo>> routes = ptr_dijkstra_router_->BuildRoutes(idx_from, targets);
+        for (size_t i = 0; i < routes.size(); ++i) {
+            result[positions[i]] = std::move(routes[i]);
+        }
+    } else {
+        for (size_t i = 0; i < targets.size(); ++i) {
+            result[positions[i]] = BuildRoute(idx_from, targets[i]);
+        }
+    }
+    return result;
+}
+
+bool RouteGraph::HasOneToMany() const {
+    return routing_settings_.router_type == RouterType::DIJKSTRA;
+}
+
 // заполняем отклик на основании данных из о пути из графа.
-void RouteGraph::FillResponse(const ROUTER::RouteInfo & route_info, domain::STAT_RESP_ROUTE & route_response ) {
-    route_response.total_time = route_info.weight;
-    route_response.items.clear();
+void RouteGraph::FillResponse(const ROUTER::RouteInfo & route_info, domain::STAT_ROUTE & route) const {
+    route.total_time = route_info.weight;
+    route.items.clear();
+    route.items.reserve(route_info.edges.size());
+    bool riding = false;
     for (graph::EdgeId eid : route_info.edges) {
         const std::pair<EDGE_TYPE, EDGE_DATA> & edge = et_by_eid_[eid];
         const Ed & ed = graph_.GetEdge(eid);
+        if (edge.first == EDGE_TYPE::et_Ride) {
+            // соседние перегоны одной поездки объединяем в один элемент
+            if (riding) {
+                auto & item_bus = route.items.back().Bus();
+                item_bus.span_count += 1;
+                item_bus.time       += ed.weight;
+            } else {
+                STAT_RESP_ROUTE_ITEM_BUS item_bus;
+                item_bus.bus        = std::get<RidingBus>(edge.second).bus_->id;
+                item_bus.span_count = 1;
+                item_bus.time       = ed.weight;
+                route.items.emplace_back(STAT_RESP_ROUTE_ITEM{STAT_RESP_ROUTE_ITEM_TYPE::BUS, std::move(item_bus)});
+            }
+            riding = true;
+            continue;
+        }
+        riding = false;
         if (edge.first == EDGE_TYPE::et_Bus) {
             RidingBus bus_context = std::get<RidingBus>(edge.second);
             const domain::Bus * pBus = bus_context.bus_;
@@ -53,25 +112,42 @@ void RouteGraph::FillResponse(const ROUTER::RouteInfo & route_info, domain::STAT
             item_bus.bus        = pBus->id;
             item_bus.span_count = bus_context.span_count_;
             item_bus.time       = ed.weight;
-            route_response.items.emplace_back(STAT_RESP_ROUTE_ITEM{STAT_RESP_ROUTE_ITEM_TYPE::BUS, std::move(item_bus)});
+            route.items.emplace_back(STAT_RESP_ROUTE_ITEM{STAT_RESP_ROUTE_ITEM_TYPE::BUS, std::move(item_bus)});
         } else if (edge.first == EDGE_TYPE::et_Wait) {
             const domain::Stop* pStop = std::get<const domain::Stop*>(edge.second);
             STAT_RESP_ROUTE_ITEM_WAIT item_wait;
             item_wait.stop_name = pStop->name;
             item_wait.time = ed.weight;
-            route_response.items.emplace_back(STAT_RESP_ROUTE_ITEM{STAT_RESP_ROUTE_ITEM_TYPE::WAIT, std::move(item_wait)});
+            route.items.emplace_back(STAT_RESP_ROUTE_ITEM{STAT_RESP_ROUTE_ITEM_TYPE::WAIT, std::move(item_wait)});
         }
     }
 }
 
 // построин ли уже был граф?
 bool RouteGraph::isPrepared() const {
-    return (ptr_router_ != nullptr);
+    return (ptr_router_ != nullptr || ptr_dijkstra_router_ != nullptr || ptr_ch_router_ != nullptr);
+}
+
+const RouteGraph::GRAPH & RouteGraph::GetGraph() const {
+    return graph_;
+}
+
+// ищем путь между вершинами маршрутизатором, выбранным в настройках
+std::optional<RouteGraph::ROUTER::RouteInfo> RouteGraph::BuildRoute(graph::VertexId from, graph::VertexId to) const {
+    switch (routing_settings_.router_type) {
+    case RouterType::DIJKSTRA:
+        return ptr_dijkstra_router_->BuildRoute(from, to);
+    case RouterType::CONTRACTION_HIERARCHIES:
+        return ptr_ch_router_->BuildRoute(from, to);
+    case RouterType::FLOYD_WARSHALL:
+        break;
+    }
+    return ptr_router_->BuildRoute(from, to);
 }
 
 // конвертируем указанное расстояние в метрах во
 // время, которое будет затрачено при указанной скорости
-double RouteGraph::DistanceToTime(size_t distance) {
+double RouteGraph::DistanceToTime(size_t distance) const {
     double result = distance;
 #if 1
     result /= (routing_settings_.bus_velocity * 5 / 18);
@@ -82,27 +158,125 @@ double RouteGraph::DistanceToTime(size_t distance) {
 
 // получаем контекст указанной вершины
 RouteGraph::VertexContext * RouteGraph::GetContextForStop(const domain::Stop * pStop) {
-    auto it_ctx = ctx_by_stop_.find(pStop);
-    if (it_ctx != ctx_by_stop_.end()) {
-        return it_ctx->second;
+    VertexContext * result = &ctx_by_stop_[pStop->index];
+    if (result->InGraph()) {
+        return result;
     }
-    VertexContext * result = new VertexContext; // удаляется в деструкторе нашего класса
-    ctx_by_stop_[pStop]  = result;
     result->idx_waiting_ = current_vertex_id_++;
-    result->idx_arrive_  = current_vertex_id_++;
+    if (routing_settings_.graph_model == GraphModel::ALL_SPANS) {
+        result->idx_arrive_  = current_vertex_id_++;
+    }
     return result;
 }
 
+// добавляем ребро в граф вместе с его описанием. идентификаторы ребер
+// выдаются подряд, поэтому описание кладем в конец et_by_eid_.
+graph::EdgeId RouteGraph::AddEdge(const Ed & edge, EDGE_TYPE type, EDGE_DATA data) {
+    const graph::EdgeId eid = graph_.AddEdge(edge);
+    assert(eid == et_by_eid_.size());
+    et_by_eid_.emplace_back(type, data);
+    return eid;
+}
+
+// резервируем место под edge_count ребер и их описаний
+void RouteGraph::ReserveEdges(size_t edge_count) {
+    et_by_eid_.clear();
+    et_by_eid_.reserve(edge_count);
+    graph_.ReserveEdges(edge_count);
+}
+
+// получаем уже созданный контекст остановки. в отличие от GetContextForStop()
+// ничего не меняет, поэтому может вызываться из нескольких потоков.
+const RouteGraph::VertexContext * RouteGraph::FindContext(const domain::Stop * pStop) const {
+    const VertexContext * result = &ctx_by_stop_[pStop->index];
+    assert(result->InGraph());
+    return result;
+}
+
+// записываем ребро в очередной слот
+void RouteGraph::EdgeWriter::AddEdge(const Ed & edge, EDGE_TYPE type, EDGE_DATA data) {
+    assert(pos < end);
+    edges[pos] = edge;
+    infos[pos] = std::make_pair(type, data);
+    ++pos;
+}
+
+// считаем, сколько ребер создаст Prepare() для маршрута в текущей модели графа
+size_t RouteGraph::CountBusEdges(const domain::Bus * pBus) const {
+    const size_t n = pBus->stops.size();
+    if (n < 2) {
+        return (routing_settings_.graph_model == GraphModel::ALL_SPANS && !pBus->is_round_trip) ? n : 0;
+    }
+    if (routing_settings_.graph_model == GraphModel::ON_BOARD) {
+        // перегон, высадка и посадка на каждый переход между остановками
+        return 3 * (n - 1) * (pBus->is_round_trip ? 1 : 2);
+    } else if (pBus->is_round_trip) {
+        // ожидание на каждой остановке кроме последней и пути между всеми парами
+        return (n - 1) + n * (n - 1) / 2;
+    }
+    // ожидание на каждой остановке и пути между всеми парами в обе стороны
+    return n + n * (n - 1);
+}
+
+// выдаем номера вершин остановкам и вершинам "в автобусе" в том же порядке,
+// в котором их выдавал бы последовательный обход маршрутов. для модели
+// ON_BOARD возвращает номера вершин "в автобусе" подряд для всех проходов
+// маршрутов, а в on_board_offsets - начало данных каждого маршрута.
+std::vector<graph::VertexId> RouteGraph::LayoutVertices(const std::vector<const domain::Bus*> & buses,
+                                                        std::vector<size_t> & on_board_offsets) {
+    std::vector<graph::VertexId> on_board_vertices;
+    on_board_offsets.assign(buses.size(), 0);
+    for (size_t b = 0; b < buses.size(); ++b) {
+        const Bus * pBus = buses[b];
+        const size_t count = pBus->stops.size();
+        if (routing_settings_.graph_model != GraphModel::ON_BOARD) {
+            for (const Stop * pStop : pBus->stops) {
+                GetContextForStop(pStop);
+            }
+            continue;
+        }
+        on_board_offsets[b] = on_board_vertices.size();
+        for (bool reverse : {false, true}) {
+            if (reverse && pBus->is_round_trip) {
+                break;
+            }
+            for (size_t i = 0; i < count; ++i) {
+                GetContextForStop(pBus->stops[reverse ? count - 1 - i : i]);
+                on_board_vertices.push_back(current_vertex_id_++);
+            }
+        }
+    }
+    return on_board_vertices;
+}
+
+// строим ребра одного маршрута
+void RouteGraph::PrepareBus(const domain::Bus * pBus, const graph::VertexId * on_board_vertices, EdgeWriter & sink) const {
+    if (routing_settings_.graph_model == GraphModel::ON_BOARD) {
+        PrepareRouteOnBoard(pBus, false, on_board_vertices, sink);
+        if (!pBus->is_round_trip) {
+            PrepareRouteOnBoard(pBus, true, on_board_vertices + pBus->stops.size(), sink);
+        }
+    } else if (pBus->is_round_trip) {
+        PrepareRouteRing(pBus, sink);
+    } else {
+        PrepareRouteNotRing(pBus, sink);
+    }
+}
+
 // создаем кольцевой маршрут
-void RouteGraph::PrepareRouteRing(const domain::Bus * pBus) {
+void RouteGraph::PrepareRouteRing(const domain::Bus * pBus, EdgeWriter & sink) const {
     assert(pBus);
     assert(pBus->is_round_trip == true);
+    // в кольце из одной остановки ехать некуда, ребер нет (см. CountBusEdges)
+    if (pBus->stops.size() < 2) {
+        return;
+    }
 
     std::vector<Ty> lengths; // информация о весах ребер для span_cout == 1
     for (size_t i = 0, ie = pBus->stops.size()-1; i < ie; ++i) {
         // получаем либо создаем контекст данной остановки
         const Stop * pStopA = pBus->stops[i];
-        VertexContext * vctxA = GetContextForStop(pStopA);
+        const VertexContext * vctxA = FindContext(pStopA);
 
         // создаем ребро ожидания на данной остановке
         Ed e_waitA;
@@ -111,12 +285,11 @@ void RouteGraph::PrepareRouteRing(const domain::Bus * pBus) {
         e_waitA.to     = vctxA->idx_arrive_;
 
         // добавим в граф
-        auto wid = graph_.AddEdge(e_waitA);
-        et_by_eid_[wid] = std::make_pair(EDGE_TYPE::et_Wait, pStopA);
+        sink.AddEdge(e_waitA, EDGE_TYPE::et_Wait, pStopA);
 
         // информация об остановке назначения
         const Stop * pStopB = pBus->stops[(i+1) % pBus->stops.size()];
-        VertexContext * vctxB = GetContextForStop(pStopB);
+        const VertexContext * vctxB = FindContext(pStopB);
         size_t distance = db_.GetDistanceBetween( pStopA, pStopB );
 
         // создаем ребро поездки, при span_count == 1
@@ -124,36 +297,36 @@ void RouteGraph::PrepareRouteRing(const domain::Bus * pBus) {
         e_stopB.weight = DistanceToTime(distance);
         e_stopB.from   = e_waitA.to;
         e_stopB.to     = vctxB->idx_waiting_;
-        wid = graph_.AddEdge(e_stopB);
-        et_by_eid_[wid] = std::make_pair(EDGE_TYPE::et_Bus, RidingBus{1, pBus});
+        sink.AddEdge(e_stopB, EDGE_TYPE::et_Bus, RidingBus{1, pBus});
 
         lengths.push_back(e_stopB.weight);
     }
-    // создаем пути со span_count >= 2
+    // создаем пути со span_count >= 2. вес пути накапливаем по мере удаления
+    // от остановки i, так что каждое ребро стоит O(1) вместо O(span_count)
     for (size_t i = 0, ie = pBus->stops.size() - 2; i < ie; ++i) {
         const Stop * pStopA = pBus->stops[i];
-        VertexContext * vctxA = GetContextForStop(pStopA);
+        const VertexContext * vctxA = FindContext(pStopA);
+        Ty weight = 0.0 + lengths[i];
         for (size_t j = i + 2; j < pBus->stops.size(); ++j) {
             const Stop * pStopB = pBus->stops[j % (pBus->stops.size()-1)];
-            VertexContext * vctxB = GetContextForStop(pStopB);
+            const VertexContext * vctxB = FindContext(pStopB);
+            weight += lengths[j - 1];
             Ed e_stopB;
             e_stopB.from   = vctxA->idx_arrive_;
             e_stopB.to     = vctxB->idx_waiting_;
-            e_stopB.weight = 0.0;
-            size_t span_count = j - i;
-            for (size_t cnt = 0; cnt < span_count; ++cnt) {
-                e_stopB.weight += lengths[(i + cnt) % lengths.size()];
-            }
-            auto wid = graph_.AddEdge(e_stopB);
-            et_by_eid_[wid] = std::make_pair(EDGE_TYPE::et_Bus, RidingBus{span_count, pBus});
+            e_stopB.weight = weight;
+            sink.AddEdge(e_stopB, EDGE_TYPE::et_Bus, RidingBus{j - i, pBus});
         }
     }
 } // PrepareRouteRing()
 
 // не кольцевой маршрут
-void RouteGraph::PrepareRouteNotRing(const domain::Bus * pBus) {
+void RouteGraph::PrepareRouteNotRing(const domain::Bus * pBus, EdgeWriter & sink) const {
     assert(pBus);
     assert(pBus->is_round_trip == false);
+    if (pBus->stops.empty()) {
+        return;
+    }
 
     std::vector<Ty> lengths_up; // храним веса ребер между соедененными остановками
                                 // для прохода в прямом направлении
@@ -161,7 +334,7 @@ void RouteGraph::PrepareRouteNotRing(const domain::Bus * pBus) {
     for (size_t i = 0;; ++i) {
         // получаем контекси для соответствующей остановки
         const Stop * pStopA = pBus->stops[i];
-        VertexContext * vctxA = GetContextForStop(pStopA);
+        const VertexContext * vctxA = FindContext(pStopA);
 
         // создаем ребро ожидания
         Ed e_waitA;
@@ -169,15 +342,14 @@ void RouteGraph::PrepareRouteNotRing(const domain::Bus * pBus) {
         e_waitA.from   = vctxA->idx_waiting_;
         e_waitA.to     = vctxA->idx_arrive_;
 
-        auto wid = graph_.AddEdge(e_waitA);
-        et_by_eid_[wid] = std::make_pair(EDGE_TYPE::et_Wait, pStopA);
+        sink.AddEdge(e_waitA, EDGE_TYPE::et_Wait, pStopA);
 
         // нужно ли создавать ребро поездки?
         if (i + 1 >= pBus->stops.size()) break;
 
         // получаем информации о следующей остановке
         const Stop * pStopB = pBus->stops[(i+1)];
-        VertexContext * vctxB = GetContextForStop(pStopB);
+        const VertexContext * vctxB = FindContext(pStopB);
 
         size_t distance = db_.GetDistanceBetween( pStopA, pStopB );
 
@@ -188,12 +360,15 @@ void RouteGraph::PrepareRouteNotRing(const domain::Bus * pBus) {
         e_stopB.weight = DistanceToTime(distance);
         e_stopB.from   = e_waitA.to;
         e_stopB.to     = vctxB->idx_waiting_;
-        wid = graph_.AddEdge(e_stopB);
-        et_by_eid_[wid] = std::make_pair(EDGE_TYPE::et_Bus, RidingBus{1, pBus});
+        sink.AddEdge(e_stopB, EDGE_TYPE::et_Bus, RidingBus{1, pBus});
 
         // запоминаем вес ребра для последующих
         lengths_up.push_back(e_stopB.weight);
     }
+    // у маршрута из одной остановки есть только ребро ожидания
+    if (pBus->stops.size() < 2) {
+        return;
+    }
 
     // идем в обратном направлении
     std::vector<Ty> lengths_dn;
@@ -204,75 +379,370 @@ void RouteGraph::PrepareRouteNotRing(const domain::Bus * pBus) {
 
         // оба контектса созданы в цикле выше, и уже
         // должны существовать
-        VertexContext * vctxA = GetContextForStop(pStopA);
+        const VertexContext * vctxA = FindContext(pStopA);
         assert(vctxA);
 
-        VertexContext * vctxB = GetContextForStop(pStopB);
+        const VertexContext * vctxB = FindContext(pStopB);
         assert(vctxB);
 
         Ed edge;
         edge.weight = DistanceToTime(distance);
         edge.from   = vctxA->idx_arrive_;
         edge.to     = vctxB->idx_waiting_;
-        auto wid    = graph_.AddEdge(edge);
-        et_by_eid_[wid] = std::make_pair(EDGE_TYPE::et_Bus, RidingBus{1, pBus});
+        sink.AddEdge(edge, EDGE_TYPE::et_Bus, RidingBus{1, pBus});
 
         lengths_dn.push_back(edge.weight);
     }
 
-    // создаем пути со span_count >= 2 в прямом направлении
+    // создаем пути со span_count >= 2 в прямом направлении, накапливая вес
+    // по мере удаления от остановки i
     for (size_t i = 0, ie = pBus->stops.size() - 2; i < ie; ++i) {
         const Stop * pStopA = pBus->stops[i];
-        VertexContext * vctxA = GetContextForStop(pStopA);
+        const VertexContext * vctxA = FindContext(pStopA);
+        Ty weight = 0.0 + lengths_up[i];
         for (size_t j = i + 2, je = pBus->stops.size(); j < je; ++j) {
             const Stop * pStopB = pBus->stops[j];
-            VertexContext * vctxB = GetContextForStop(pStopB);
+            const VertexContext * vctxB = FindContext(pStopB);
+            weight += lengths_up[j - 1];
             Ed e_stopB;
             e_stopB.from   = vctxA->idx_arrive_;
             e_stopB.to     = vctxB->idx_waiting_;
-            e_stopB.weight = 0.0;
-            size_t span_count = j - i;
-            for (size_t cnt = 0; cnt < span_count; ++cnt) {
-                e_stopB.weight += lengths_up[(i + cnt) % lengths_up.size()];
-            }
-            auto wid = graph_.AddEdge(e_stopB);
-            et_by_eid_[wid] = std::make_pair(EDGE_TYPE::et_Bus, RidingBus{span_count, pBus});
+            e_stopB.weight = weight;
+            sink.AddEdge(e_stopB, EDGE_TYPE::et_Bus, RidingBus{j - i, pBus});
         }
     }
     // создаем пути со span_count >= 2 в обратном направлении
     std::reverse(lengths_dn.begin(), lengths_dn.end());
     for (size_t i = pBus->stops.size()-1; i >= 2; --i) {
         const Stop * pStopA = pBus->stops[i];
-        VertexContext * vctxA = GetContextForStop(pStopA);
+        const VertexContext * vctxA = FindContext(pStopA);
+        Ty weight = 0.0 + lengths_dn[i - 1];
         for (size_t j = i - 2;; --j) {
             const Stop * pStopB = pBus->stops[j];
-            VertexContext * vctxB = GetContextForStop(pStopB);
+            const VertexContext * vctxB = FindContext(pStopB);
+            weight += lengths_dn[j];
             Ed e_stopB;
             e_stopB.from   = vctxA->idx_arrive_;
             e_stopB.to     = vctxB->idx_waiting_;
-            e_stopB.weight = 0.0;
-            size_t span_count = i - j;
-            for (size_t cnt = 0; cnt < span_count; ++cnt) {
-                e_stopB.weight += lengths_dn[(i - cnt - 1)];
-            }
-            auto wid = graph_.AddEdge(e_stopB);
-            et_by_eid_[wid] = std::make_pair(EDGE_TYPE::et_Bus, RidingBus{span_count, pBus});
+            e_stopB.weight = weight;
+            sink.AddEdge(e_stopB, EDGE_TYPE::et_Bus, RidingBus{i - j, pBus});
             if (j == 0) break;
         }
     }
 } // PrepareRouteNotRing()
 
-// поочередно пересчитываем информацию о всех маршрутах.
-void RouteGraph::Prepare() {
-//    LOG_DURATION(__FUNCTION__);
+// маршрут в модели ON_BOARD. для каждой остановки маршрута создается вершина
+// "в автобусе", соседние такие вершины соединены ребрами перегонов, а с
+// вершиной ожидания остановки - ребрами посадки (ожидание) и высадки.
+// число ребер растет линейно от длины маршрута. номера вершин "в автобусе"
+// заранее выданы в LayoutVertices() и переданы в on_board_vertices.
+void RouteGraph::PrepareRouteOnBoard(const domain::Bus * pBus, bool reverse,
+                                     const graph::VertexId * on_board_vertices, EdgeWriter & sink) const {
+    assert(pBus);
+    const size_t count = pBus->stops.size();
+    graph::VertexId prev_on_board = 0;
+    const Stop * pPrevStop = nullptr;
+    for (size_t i = 0; i < count; ++i) {
+        const Stop * pStop = pBus->stops[reverse ? count - 1 - i : i];
+        const VertexContext * vctx = FindContext(pStop);
+        const graph::VertexId on_board = on_board_vertices[i];
+
+        if (pPrevStop != nullptr) {
+            // перегон от предыдущей остановки
+            Ed e_ride;
+            e_ride.weight = DistanceToTime(db_.GetDistanceBetween( pPrevStop, pStop ));
+            e_ride.from   = prev_on_board;
+            e_ride.to     = on_board;
+            sink.AddEdge(e_ride, EDGE_TYPE::et_Ride, RidingBus{1, pBus});
+
+            // высадка на остановке
+            Ed e_alight;
+            e_alight.weight = 0.0;
+            e_alight.from   = on_board;
+            e_alight.to     = vctx->idx_waiting_;
+            sink.AddEdge(e_alight, EDGE_TYPE::et_Alight, pStop);
+        }
+        if (i + 1 < count) {
+            // посадка, с конечной остановки дальше не едем
+            Ed e_board;
+            e_board.weight = routing_settings_.bus_wait_time;
+            e_board.from   = vctx->idx_waiting_;
+            e_board.to     = on_board;
+            sink.AddEdge(e_board, EDGE_TYPE::et_Wait, pStop);
+        }
+        prev_on_board = on_board;
+        pPrevStop = pStop;
+    }
+} // PrepareRouteOnBoard()
+
+// пересчитываем информацию о всех маршрутах. номера вершин выдаются
+// последовательно, а число ребер каждого маршрута известно заранее, поэтому
+// номера его ребер - непрерывный диапазон, который можно заполнить в любом
+// потоке. ребра маршрутов строятся в thread_count потоков, а результат, как и
+// ответы на запросы, от числа потоков не зависит.
+void RouteGraph::Prepare(size_t thread_count) {
+    {
+        METRICS_SCOPE(metrics::Timer::GRAPH_BUILD);
+        BuildGraph(thread_count);
+    }
+    METRICS_SCOPE(metrics::Timer::ROUTER_PRECOMPUTE);
+    CreateRouter(std::nullopt, std::nullopt);
+}
+
+void RouteGraph::BuildGraph(size_t thread_count) {
+    const std::vector<const Bus*> buses(db_.begin(), db_.end());
+
     current_vertex_id_ = 0;
-    for ( const auto & bus_id : db_ ) {
-        const Bus * pBus = db_.GetBusPtr(bus_id);
-        if (pBus->is_round_trip) {
-            PrepareRouteRing(pBus);
+    ctx_by_stop_.assign(db_.StopCount(), VertexContext{});
+    size_t vertex_count = graph_.GetVertexCount();
+    if (routing_settings_.graph_model == GraphModel::ON_BOARD) {
+        // вершина на остановку и по вершине на каждую остановку каждого прохода маршрута
+        vertex_count = db_.StopCount();
+        for (const Bus * pBus : buses) {
+            vertex_count += pBus->stops.size() * (pBus->is_round_trip ? 1 : 2);
+        }
+    }
+    std::vector<size_t> on_board_offsets;
+    const std::vector<graph::VertexId> on_board_vertices = LayoutVertices(buses, on_board_offsets);
+
+    // первый номер ребра каждого маршрута
+    std::vector<size_t> edge_offsets(buses.size() + 1, 0);
+    for (size_t b = 0; b < buses.size(); ++b) {
+        edge_offsets[b + 1] = edge_offsets[b] + CountBusEdges(buses[b]);
+    }
+    const size_t edge_count = edge_offsets.back();
+    std::vector<Ed> edges(edge_count);
+    et_by_eid_.assign(edge_count, {});
+
+    // делим маршруты на непрерывные группы с примерно равным числом ребер.
+    // групп больше, чем потоков, чтобы освободившийся поток брал следующую.
+    thread_count = std::max<size_t>(1, std::min(thread_count, buses.size()));
+    const size_t chunk_edges = std::max<size_t>(1, edge_count / (thread_count * 4));
+    std::vector<size_t> chunk_begins{0};
+    for (size_t b = 1; b < buses.size(); ++b) {
+        if (edge_offsets[b] - edge_offsets[chunk_begins.back()] >= chunk_edges) {
+            chunk_begins.push_back(b);
+        }
+    }
+    chunk_begins.push_back(buses.size());
+    const size_t chunk_count = chunk_begins.size() - 1;
+
+    std::atomic<size_t> next_chunk{0};
+    std::vector<std::exception_ptr> errors(thread_count);
+    auto worker = [&](size_t worker_index) {
+        try {
+            for (size_t c = next_chunk++; c < chunk_count; c = next_chunk++) {
+                for (size_t b = chunk_begins[c]; b < chunk_begins[c + 1]; ++b) {
+                    EdgeWriter writer{edges.data(), et_by_eid_.data(), edge_offsets[b], edge_offsets[b + 1]};
+                    PrepareBus(buses[b], on_board_vertices.data() + on_board_offsets[b], writer);
+                    assert(writer.pos == writer.end);
+                }
+            }
+        } catch (...) {
+            errors[worker_index] = std::current_exception();
+        }
+    };
+    std::vector<std::thread> threads;
+    threads.reserve(thread_count - 1);
+    for (size_t t = 1; t < thread_count; ++t) {
+        threads.emplace_back(worker, t);
+    }
+    worker(0);
+    for (std::thread & thread : threads) {
+        thread.join();
+    }
+    for (const std::exception_ptr & error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+
+    graph_ = GRAPH(vertex_count, std::move(edges));
+    METRICS_ADD(metrics::Counter::GRAPH_EDGES, edge_count);
+} // BuildGraph()
+
+// создаем маршрутизатор, выбранный в настройках. если предвычисленные данные
+// Floyd–Warshall или иерархия сжатия уже есть, то используем их вместо
+// повторного расчета.
+void RouteGraph::CreateRouter(std::optional<ROUTER::RoutesInternalData> routes_internal_data,
+                              std::optional<CH_ROUTER::Hierarchy> hierarchy) {
+    switch (routing_settings_.router_type) {
+    case RouterType::DIJKSTRA:
+        csr_graph_ = CSR_GRAPH(graph_);
+        ptr_dijkstra_router_.reset(new DIJKSTRA_ROUTER(csr_graph_));
+        break;
+    case RouterType::CONTRACTION_HIERARCHIES:
+        if (hierarchy.has_value()) {
+            ptr_ch_router_.reset(new CH_ROUTER(graph_, std::move(hierarchy.value())));
         } else {
-            PrepareRouteNotRing(pBus);
+            ptr_ch_router_.reset(new CH_ROUTER(graph_));
+            METRICS_ADD(metrics::Counter::CH_SHORTCUTS, ptr_ch_router_->GetHierarchy().shortcuts.size());
         }
+        break;
+    case RouterType::FLOYD_WARSHALL:
+        if (routes_internal_data.has_value()) {
+            ptr_router_.reset(new ROUTER(graph_, std::move(routes_internal_data.value())));
+        } else {
+            ptr_router_.reset(new ROUTER(graph_));
+        }
+        break;
+    }
+}
+
+// сохраняем подготовленный граф и данные маршрутизатора
+RouteGraph::Snapshot RouteGraph::Save() const {
+    assert(isPrepared());
+    Snapshot result;
+    result.vertex_count = graph_.GetVertexCount();
+    // вершины идут в порядке номеров остановок
+    for (size_t stop_index = 0; stop_index < ctx_by_stop_.size(); ++stop_index) {
+        const VertexContext & ctx = ctx_by_stop_[stop_index];
+        if (ctx.InGraph()) {
+            result.vertices.push_back({stop_index, ctx.idx_waiting_, ctx.idx_arrive_});
+        }
+    }
+
+    const size_t edge_count = graph_.GetEdgeCount();
+    result.edges.reserve(edge_count);
+    result.edge_infos.reserve(edge_count);
+    for (graph::EdgeId eid = 0; eid < edge_count; ++eid) {
+        result.edges.push_back(graph_.GetEdge(eid));
+        Snapshot::EdgeInfo info;
+        const auto & [type, data] = et_by_eid_[eid];
+        info.type = type;
+        if (type == EDGE_TYPE::ed_Unknown) {
+            // ребро без описания
+        } else if (std::holds_alternative<const domain::Stop*>(data)) {
+            info.index = std::get<const domain::Stop*>(data)->index;
+        } else {
+            const RidingBus & riding = std::get<RidingBus>(data);
+            info.index      = riding.bus_->index;
+            info.span_count = riding.span_count_;
+        }
+        result.edge_infos.push_back(info);
+    }
+
+    if (ptr_router_) {
+        result.routes_internal_data = ptr_router_->GetRoutesInternalData();
+    }
+    if (ptr_ch_router_) {
+        result.hierarchy = ptr_ch_router_->GetHierarchy();
     }
-    ptr_router_.reset(new ROUTER(graph_));
-} // Prepare()
+    return result;
+} // Save()
+
+bool RouteGraph::Snapshot::IsValid(size_t stop_count, size_t bus_count) const {
+    constexpr graph::VertexId NO_VERTEX = std::numeric_limits<graph::VertexId>::max();
+    for (const Vertex & vertex : vertices) {
+        if (vertex.stop_index >= stop_count || vertex.idx_waiting >= vertex_count
+                || (vertex.idx_arrive != NO_VERTEX && vertex.idx_arrive >= vertex_count)) {
+            return false;
+        }
+    }
+
+    const size_t edge_count = edges.size();
+    if (edge_infos.size() != edge_count) {
+        return false;
+    }
+    for (size_t i = 0; i < edge_count; ++i) {
+        if (edges[i].from >= vertex_count || edges[i].to >= vertex_count) {
+            return false;
+        }
+        switch (edge_infos[i].type) {
+        case EDGE_TYPE::ed_Unknown:
+            break;
+        case EDGE_TYPE::et_Wait:
+        case EDGE_TYPE::et_Alight:
+            if (edge_infos[i].index >= stop_count) {
+                return false;
+            }
+            break;
+        case EDGE_TYPE::et_Bus:
+        case EDGE_TYPE::et_Ride:
+            if (edge_infos[i].index >= bus_count) {
+                return false;
+            }
+            break;
+        default:
+            return false;
+        }
+    }
+
+    if (routes_internal_data.has_value()) {
+        const auto & routes = routes_internal_data.value();
+        if (routes.size() != vertex_count) {
+            return false;
+        }
+        for (const auto & row : routes) {
+            if (row.size() != vertex_count) {
+                return false;
+            }
+            for (const auto & route : row) {
+                if (route && route->prev_edge && *route->prev_edge >= edge_count) {
+                    return false;
+                }
+            }
+        }
+    }
+
+    if (hierarchy.has_value()) {
+        if (hierarchy->ranks.size() != vertex_count) {
+            return false;
+        }
+        // ранги - перестановка 0..V-1: при повторном ранге поиск вверх по
+        // рангам молча теряет пути
+        std::vector<bool> seen_ranks(vertex_count, false);
+        for (size_t rank : hierarchy->ranks) {
+            if (rank >= vertex_count || seen_ranks[rank]) {
+                return false;
+            }
+            seen_ranks[rank] = true;
+        }
+        // сокращение раскрывается в ребра и сокращения с меньшими номерами
+        graph::EdgeId shortcut_id = edge_count;
+        for (const auto & shortcut : hierarchy->shortcuts) {
+            if (shortcut.from >= vertex_count || shortcut.to >= vertex_count
+                    || shortcut.first >= shortcut_id || shortcut.second >= shortcut_id) {
+                return false;
+            }
+            ++shortcut_id;
+        }
+    }
+    return true;
+}
+
+// восстанавливаем граф из сохраненных данных вместо вызова Prepare()
+bool RouteGraph::Load(Snapshot snapshot) {
+    METRICS_SCOPE(metrics::Timer::ROUTER_LOAD);
+    if (!snapshot.IsValid(db_.StopCount(), db_.BusCount())) {
+        return false;
+    }
+    ctx_by_stop_.assign(db_.StopCount(), VertexContext{});
+    et_by_eid_.clear();
+    ptr_router_.reset();
+    ptr_dijkstra_router_.reset();
+    ptr_ch_router_.reset();
+
+    for (const Snapshot::Vertex & vertex : snapshot.vertices) {
+        VertexContext & ctx = ctx_by_stop_[vertex.stop_index];
+        ctx.idx_waiting_ = vertex.idx_waiting;
+        ctx.idx_arrive_  = vertex.idx_arrive;
+    }
+    current_vertex_id_ = snapshot.vertex_count;
+
+    graph_ = GRAPH(snapshot.vertex_count);
+    ReserveEdges(snapshot.edges.size());
+    for (size_t i = 0; i < snapshot.edges.size(); ++i) {
+        const Snapshot::EdgeInfo & info = snapshot.edge_infos[i];
+        if (info.type == EDGE_TYPE::et_Wait || info.type == EDGE_TYPE::et_Alight) {
+            AddEdge(snapshot.edges[i], info.type, db_.GetStopByIndex(info.index));
+        } else if (info.type == EDGE_TYPE::et_Bus || info.type == EDGE_TYPE::et_Ride) {
+            AddEdge(snapshot.edges[i], info.type, RidingBus{info.span_count, db_.GetBusByIndex(info.index)});
+        } else {
+            AddEdge(snapshot.edges[i], EDGE_TYPE::ed_Unknown, EDGE_DATA{});
+        }
+    }
+
+    CreateRouter(std::move(snapshot.routes_internal_data), std::move(snapshot.hierarchy));
+    return true;
+} // Load()
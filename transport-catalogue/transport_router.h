@@ -1,11 +1,14 @@
 #pragma once
 
-#include <unordered_map>
 #include <memory>
 #include <limits>
+#include <optional>
+#include <vector>
 
 #include "graph.h"
 #include "router.h"
+#include "dijkstra_router.h"
+#include "contraction_hierarchy.h"
 #include "domain.h"
 
 namespace tcatalogue {
@@ -17,20 +20,80 @@ public:
     using Ty = double;
     using Ed = graph::Edge<Ty>;
     using GRAPH = graph::DirectedWeightedGraph<Ty>;
+    using CSR_GRAPH = graph::CsrGraph<Ty>;
     using ROUTER = graph::Router<Ty>;
+    using DIJKSTRA_ROUTER = graph::DijkstraRouter<Ty>;
+    using CH_ROUTER = graph::ContractionHierarchy<Ty>;
+
+    enum class EDGE_TYPE {
+        ed_Unknown,
+        et_Wait,    // ожидание автобуса на остановке (в модели ON_BOARD - посадка)
+        et_Bus,     // поездка на span_count остановок
+        et_Ride,    // перегон между соседними остановками в модели ON_BOARD
+        et_Alight,  // высадка на остановке в модели ON_BOARD
+    };
+
+    // подготовленный граф в виде, пригодном для сохранения в базу.
+    // остановки и маршруты в нем заданы порядковыми номерами в каталоге.
+    struct Snapshot {
+        struct Vertex {
+            size_t stop_index = 0;
+            graph::VertexId idx_waiting = 0;
+            graph::VertexId idx_arrive = 0;
+        };
+        struct EdgeInfo {
+            EDGE_TYPE type = EDGE_TYPE::ed_Unknown;
+            size_t index = 0;      // остановка для et_Wait, маршрут для et_Bus
+            size_t span_count = 0;
+        };
+        size_t vertex_count = 0;
+        std::vector<Vertex> vertices;
+        std::vector<Ed> edges;
+        std::vector<EdgeInfo> edge_infos; // по одной записи на каждое ребро edges
+        std::optional<ROUTER::RoutesInternalData> routes_internal_data;
+        std::optional<CH_ROUTER::Hierarchy> hierarchy;
+
+        // все номера вершин, ребер, остановок и маршрутов в допустимых
+        // пределах, размеры таблиц согласованы с числом вершин и ребер
+        bool IsValid(size_t stop_count, size_t bus_count) const;
+    };
 
     RouteGraph(tcatalogue::TransportCatalogue & db,
                const domain::RoutingSettings &routing_settings);
 
     ~RouteGraph();
 
-    bool Build(const std::string & from, const std::string & to, ROUTER::RouteInfo & ri);
+    // Build() и FillResponse() только читают подготовленный граф и могут
+    // вызываться из нескольких потоков одновременно
+    bool Build(const std::string & from, const std::string & to, ROUTER::RouteInfo & ri) const;
+
+    bool Build(const domain::Stop * from, const domain::Stop * to, ROUTER::RouteInfo & ri) const;
 
-    void FillResponse(const ROUTER::RouteInfo & route_info, domain::STAT_RESP_ROUTE & route_response);
+    // маршруты от остановки from до каждой из остановок to: i-й элемент -
+    // маршрут до to[i] или nullopt. маршрутизатор Дейкстры строит их по
+    // одному дереву кратчайших путей, остальные - по одному
+    std::vector<std::optional<ROUTER::RouteInfo>> BuildFrom(const domain::Stop * from,
+                                                            const std::vector<const domain::Stop*> & to) const;
+
+    // BuildFrom() быстрее, чем Build() для каждой пары
+    bool HasOneToMany() const;
+
+    void FillResponse(const ROUTER::RouteInfo & route_info, domain::STAT_ROUTE & route) const;
 
     bool isPrepared() const;
 
-    void Prepare();
+    const GRAPH & GetGraph() const;
+
+    // строим граф и маршрутизатор. ребра маршрутов строятся в thread_count
+    // потоков, результат от числа потоков не зависит.
+    void Prepare(size_t thread_count = 1);
+
+    // сохраняем подготовленный граф и данные маршрутизатора
+    Snapshot Save() const;
+
+    // восстанавливаем граф из сохраненных данных вместо вызова Prepare().
+    // false, если данные не подходят к каталогу; граф тогда не меняется
+    bool Load(Snapshot snapshot);
 
 private:
     tcatalogue::TransportCatalogue & db_;
@@ -38,33 +101,71 @@ private:
     graph::VertexId current_vertex_id_ = 0;
 
     GRAPH graph_;
+    CSR_GRAPH csr_graph_; // неизменяемая копия graph_ для обхода маршрутизатором
     std::shared_ptr<ROUTER> ptr_router_;
+    std::shared_ptr<DIJKSTRA_ROUTER> ptr_dijkstra_router_;
+    std::shared_ptr<CH_ROUTER> ptr_ch_router_;
 
     struct VertexContext {
         graph::VertexId idx_waiting_ = std::numeric_limits<graph::VertexId>::max();
         graph::VertexId idx_arrive_ = std::numeric_limits<graph::VertexId>::max();
-    };
-    std::unordered_map<const domain::Stop*, VertexContext*> ctx_by_stop_;
 
-    enum class EDGE_TYPE {
-        ed_Unknown,
-        et_Wait,
-        et_Bus,
+        // остановки без маршрутов в граф не попадают
+        bool InGraph() const {
+            return idx_waiting_ != std::numeric_limits<graph::VertexId>::max();
+        }
     };
+    std::vector<VertexContext> ctx_by_stop_; // по номеру остановки
+
     struct RidingBus {
         size_t span_count_ = 0;
         const domain::Bus* bus_ = nullptr;
     };
     using EDGE_DATA = std::variant<const domain::Stop*, RidingBus >;
-    std::unordered_map< graph::EdgeId, std::pair<EDGE_TYPE, EDGE_DATA> > et_by_eid_;
+    std::vector< std::pair<EDGE_TYPE, EDGE_DATA> > et_by_eid_; // индекс - EdgeId
+
+    // заполняет ребра маршрута в отведенном ему диапазоне номеров [pos, end)
+    struct EdgeWriter {
+        Ed * edges = nullptr;
+        std::pair<EDGE_TYPE, EDGE_DATA> * infos = nullptr;
+        size_t pos = 0;
+        size_t end = 0;
+
+        void AddEdge(const Ed & edge, EDGE_TYPE type, EDGE_DATA data);
+    };
+
+    double DistanceToTime(size_t distance) const;
+
+    // граф без маршрутизатора, первая часть Prepare()
+    void BuildGraph(size_t thread_count);
+    void CreateRouter(std::optional<ROUTER::RoutesInternalData> routes_internal_data,
+                      std::optional<CH_ROUTER::Hierarchy> hierarchy);
 
-    double DistanceToTime(size_t distance);
+    // ищем путь между вершинами маршрутизатором, выбранным в настройках
+    std::optional<ROUTER::RouteInfo> BuildRoute(graph::VertexId from, graph::VertexId to) const;
 
     VertexContext * GetContextForStop(const domain::Stop * pStop);
 
+    const VertexContext * FindContext(const domain::Stop * pStop) const;
+
+    graph::EdgeId AddEdge(const Ed & edge, EDGE_TYPE type, EDGE_DATA data);
+
+    void ReserveEdges(size_t edge_count);
+
+    size_t CountBusEdges(const domain::Bus * pBus) const;
+
+    std::vector<graph::VertexId> LayoutVertices(const std::vector<const domain::Bus*> & buses,
+                                                std::vector<size_t> & on_board_offsets);
+
+    void PrepareBus(const domain::Bus * pBus, const graph::VertexId * on_board_vertices, EdgeWriter & sink) const;
+
     // создаем кольцевой маршрут
-    void PrepareRouteRing(const domain::Bus * pBus);
+    void PrepareRouteRing(const domain::Bus * pBus, EdgeWriter & sink) const;
 
     // не кольцевой маршрут
-    void PrepareRouteNotRing(const domain::Bus * pBus);
+    void PrepareRouteNotRing(const domain::Bus * pBus, EdgeWriter & sink) const;
+
+    // маршрут в модели ON_BOARD, reverse - проход от конечной к началу
+    void PrepareRouteOnBoard(const domain::Bus * pBus, bool reverse,
+                             const graph::VertexId * on_board_vertices, EdgeWriter & sink) const;
 }; // class RouteGraph